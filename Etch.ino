@@ -60,7 +60,7 @@ void handleScreenViewSelect(){ fullScreen = !fullScreen; }
 
 void handleModeChange(){ dsp.setMode( menu.currentMode ); }
 
-void handleLoopPress(){ menu.checkSetting(); }
+void handleLoopPress(){ if( menu.currentMode == MODE_CAL ){ dsp.calibrateInput(); dsp.calibrateOctaves(); } else { menu.checkSetting(); } }
 
 
 /*******************************************
@@ -92,7 +92,9 @@ void setup() {
 *******************************************/
 
 void loop() {
+  dsp.process();                                                               // Keep the block engine fed (does nothing unless BLOCK_ENGINE is on)
   hw.processEvents();
+  dsp.process();
   switch( menu.currentMode ){
     case 0: // Global Menu Mode
       menu.drawMenu();                                                         // Draw the menu at the bottom of the screen
@@ -103,6 +105,7 @@ void loop() {
       // Handle Menu Callbacks:
       dsp.setLoopLength(     menu.getAudLoopLength()  );
       dsp.setMorphRate(      menu.getAudMorphRate()   );
+      dsp.setLoopPitch(      menu.getAudLoopPitch()   );
       dsp.setResonance(      menu.getAudResonance()   );
       dsp.setReverbAmount(   menu.getReverbAmount()   );
       dsp.setReverbDelay(    menu.getReverbDelay()    );
@@ -120,6 +123,7 @@ void loop() {
 
       dsp.setRoot(       menu.getRoot()         );
       dsp.setScale(      menu.getScale()        );
+      dsp.setQuantMode(  menu.getQuantMode()    );
       dsp.setLoopLength( menu.getCVLoopLength() );
       dsp.setMorphRate(  menu.getCVMorphRate()  );
 
@@ -136,6 +140,7 @@ void loop() {
       break;
   }
 
-  hw.display();                                                                // Transfer screen buffer to the actual display
+  hw.displayBegin();                                                           // Transfer screen buffer to the actual display a chunk at a time,
+  do dsp.process(); while( hw.displayChunk() );                                // keeping the block engine fed in between (See DISPLAY NOTES in hardware.h)
 }
 
@@ -0,0 +1,151 @@
+#ifndef ADC_H
+#define ADC_H
+
+/*
+   _____  ________  _________
+  /  _  \ \______ \ \_   ___ \
+ /  /_\  \ |    |  \/    \  \/
+/    |    \|    `   \     \____
+\____|__  /_______  /\______  /
+        \/        \/        \/
+
+ETCH Firmware source code designed to run on the AVR128DA28.
+Copyright (C) 2024 Tyler Klein (Things Made Simple)
+Etch Hardware Design by Juanito Moore (Modular for the Masses)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+--- Description: ---
+Register-level ADC scheduler. It owns ADC0 and shares it between the ISR and
+the knobs, so nothing ever has to stop the audio timer to read a pot.
+
+Audio/CV: Instead of calling analogRead() and waiting around for the
+conversion, each sample collects the conversion that was started on the
+previous sample and then kicks off the next one. That way the ADC converts
+sample N+1 while sample N is being processed.
+
+Controls: Once the ISR's conversion finishes (or on ticks where the ISR didn't
+need one at all) the scheduler slips a single pot/CV conversion into the gap
+before the next timer tick, working round-robin through the scan list. The
+results are published in scan[] for Hardware::processEvents() to pick up.
+
+This file only touches the ADC0 and TCA0 registers, so on the module it runs
+against the real peripherals and on a desktop it runs against the register
+mock in tools/etch-render/avr_mock.h (include the mock first).
+
+*/
+
+
+/*******************************************
+* ADC Scheduler                            *
+*******************************************/
+
+// SCHEDULER NOTES:
+// • The ISR calls adcStart() for its own channel. If a control conversion happens to still be running, the start is
+//   parked in "pending" and adcResultReady() kicks it off the moment the control conversion is done.
+// • adcResultReady() runs from the ADC0 RESRDY interrupt. It files the result (ISR channel or scan slot) and, after an
+//   ISR conversion, chains one control conversion if it will finish before the next TCA0 overflow.
+// • The audio ISR is level-1 and can pre-empt the RESRDY interrupt, so ISR(ADC0_RESRDY_vect) runs adcResultReady() with
+//   the interrupts off. The audio ISR itself can't be interrupted, so the functions it calls need no locks.
+//   loop() reads scan[] through adcScanRead(), which turns the interrupts off for the 16-bit copy.
+
+#define ADC_PIPE_CHANNELS    8                                  // The ISR reads AIN0...AIN7 (PD0...PD7)
+#define ADC_SCAN_SLOTS       8                                  // Maximum number of control channels in the round-robin
+#define ADC_CONVERSION_TICKS 400                                // TCA0 ticks a single conversion needs (about 16 uS, with some margin)
+
+struct AdcPipe {
+  uint8_t  muxpos;                                              // Channel the ISR last asked for
+  uint16_t last[ADC_PIPE_CHANNELS];                             // Latest result for each of the ISR's channels
+  bool     busy;                                                // ISR conversion in progress
+  bool     pending;                                             // ISR conversion waiting for a control conversion to finish
+  bool     scanning;                                            // Control conversion in progress
+  const uint8_t *scan_list;                                     // MUXPOS of each control channel (See Hardware::setup)
+  uint8_t  scan_count;                                          // Number of control channels
+  uint8_t  scan_index;                                          // Next control channel to convert
+  uint16_t scan[ADC_SCAN_SLOTS];                                // Latest result for each control channel
+};
+
+AdcPipe adc_pipe;                                               // The one and only ADC scheduler
+
+// Points the ADC at one of the ISR's channels and starts converting it
+inline void adcStart( AdcPipe &a, uint8_t muxpos ){
+  a.muxpos = muxpos;
+  if( a.scanning ){                                             // If a control conversion is still running, don't stomp on it.
+    a.pending = true;                                           // adcResultReady() will start this one as soon as it is done
+    return;
+  }
+  a.pending = false;
+  a.busy    = true;
+  ADC0.MUXPOS  = muxpos;
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+// Returns the latest result for the channel started by adcStart
+inline uint16_t adcCollect( AdcPipe &a ){
+  return a.last[a.muxpos & (ADC_PIPE_CHANNELS - 1)];
+}
+
+// Collects the latest result and immediately starts converting the next sample on the same channel
+inline uint16_t adcNext( AdcPipe &a ){
+  uint16_t val = adcCollect( a );
+  adcStart( a, a.muxpos );
+  return val;
+}
+
+// Slips the next control conversion into the gap before the next timer tick (if the ADC is free and there's time)
+inline void adcScanNext( AdcPipe &a ){
+  if( a.busy || a.scanning || a.pending || (a.scan_count == 0) ) return;
+  if( uint16_t(TCA0.SINGLE.PER - TCA0.SINGLE.CNT) < ADC_CONVERSION_TICKS ) return; // Not enough time left, so try again next tick
+  a.scanning = true;
+  ADC0.MUXPOS  = a.scan_list[a.scan_index];
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+// Call from the ADC0 RESRDY interrupt. Reading ADC0.RES clears the flag
+inline void adcResultReady( AdcPipe &a ){
+  uint16_t res = ADC0.RES;
+  if( a.scanning ){                                             // A control conversion just finished
+    a.scanning = false;
+    a.scan[a.scan_index] = res;                                 // Publish it and move along to the next control channel
+    if( ++a.scan_index >= a.scan_count ) a.scan_index = 0;
+    if( a.pending ) adcStart( a, a.muxpos );                    // The ISR has been waiting on us, so start its conversion now
+    return;
+  }
+  a.busy = false;                                               // One of the ISR's conversions just finished
+  a.last[a.muxpos & (ADC_PIPE_CHANNELS - 1)] = res;
+  adcScanNext( a );                                             // and the ADC is free until the next tick, so scan a control
+}
+
+// Sets up the control channel round-robin and fills scan[] with a first (blocking) pass. Call before the timer starts
+inline void adcScanSetup( AdcPipe &a, const uint8_t *list, uint8_t count ){
+  a.scan_list  = list;
+  a.scan_count = count < ADC_SCAN_SLOTS ? count : ADC_SCAN_SLOTS;
+  a.scan_index = 0;
+  ADC0.INTCTRL = 0;                                             // Poll for this first pass
+  for( uint8_t i = 0; i<a.scan_count; i++ ){
+    ADC0.MUXPOS  = list[i];
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while( !(ADC0.INTFLAGS & ADC_RESRDY_bm) );
+    a.scan[i] = ADC0.RES;
+  }
+  ADC0.INTCTRL = ADC_RESRDY_bm;                                 // From here on out, every result comes through adcResultReady()
+}
+
+// Returns the latest result for a control channel (safe to call from loop())
+inline uint16_t adcScanRead( AdcPipe &a, uint8_t slot ){
+  noInterrupts(); uint16_t val = a.scan[slot]; interrupts();
+  return val;
+}
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef DSP_H
 #define DSP_H
 
+#include "kernel.h"
+#include "adc.h"
+#include <EEPROM.h>
+
 /*
 ___________ __         .__      
 \_   _____//  |_  ____ |  |__   
@@ -49,84 +53,154 @@ like bit-crush, sample crush, low-pass filtering, reverb, scale quantizing, etc.
 #define PIN_OUTPUT    PIN_PD6                                    // Audio / CV Output
 #define PIN_OFFSET    PIN_PA1                                    // Output Offset for CV vs Audio
 
-// Clock & period settings:
-#define M_CLOCK_FRQ   25000000                                   // Master Clock Frequency of the AVR Microcontroller
-#define LOW_SAMP_FRQ  32                                         // The lowest frequency for audio sample rate (it goes up from here with the input)
-
-#define OCT_RANGE     9                                          // Number of octaves in the sample rate range
-#define ISR_OCT_RANGE 5                                          // Number of octaves that can be adjusted by the ISR
-#define UNITS_PER_OCT (1024/OCT_RANGE)                           // Number of units per octave
+#define MUX_IN_AUD    ADC_MUXPOS_AIN0_gc                         // ADC0 channels the ISR reads directly (See adc.h)
+#define MUX_IN_CV     ADC_MUXPOS_AIN1_gc                         // PIN_IN_AUD is PD0 (AIN0), PIN_IN_CV is PD1 (AIN1). Trigger mode also uses MUX_CV_SR from hardware.h
+
+// MEMORY NOTES:
+// • The AVR128DA28 only has 16 kB of RAM, so anything that never changes (font, tween curve, scale tables, menu
+//   template, phase & pitch tables) is marked PROGMEM_MAPPED and stays in the memory mapped flash.
+// • Plain const isn't enough: DxCore copies .rodata into RAM on the 128 kB parts. PROGMEM_MAPPED puts a table in the
+//   flash section DxCore maps into the data space instead, so it still reads like a normal array (no pgm_read_* needed).
+//   That goes for constexpr tables too, the compiler building them doesn't keep them out of .rodata.
+// • tools/memory-map lists what is left in RAM, and every table in the mapped flash.
+// • The buffers below are most of the RAM. Roughly: the arena 7 kB, bitcrush tables 4 kB, scope buffer 0.5 kB, plus
+//   1 kB for the OLED frame buffer that the display library allocates in setup().
+
+// ARENA NOTES:
+// • input_buffer, morph_buffer and reverb_buffer all come out of one static arena. DSP::setMode lays it out for the new
+//   mode (See ARENA_LAYOUT), so the memory audio mode spends on the reverb turns into a longer step sequence in CV mode.
+// • output_buffer stays on its own, since the oscilloscope draws it in every mode.
+// • The ISR is parked on idleKernel while the layout changes. The buffers get cleared to the layout's resting value and
+//   the positions start over, so a new mode never plays back the last mode's leftovers.
+// • Live input still records into the first BUFFER_SIZE entries (the 8-bit input_index). The rest of a longer loop
+//   fills in as the morph writes new input into it.
+// • Audio mode reads the loop buffers through audio_input & audio_morph, which hold AUDIO_LOOP_SIZE mu-law samples each in
+//   the same words (See LOOP STORAGE NOTES in kernel.h). CV mode reads them through cv_input & cv_morph, which hold
+//   CV_LOOP_STEPS one byte notes each (See CV LOOP NOTES in kernel.h). Callibration keeps using the raw 16-bit views.
+
+#define BUFFER_SIZE        256                                   // Using 256 instead of 240 so the 8-bit pointer can just roll over on its own
+#define REVERB_WORDS       3072                                  // Arena words set aside for the reverb. Uses up the RAM freed by the PROGMEM_MAPPED tables (See MEMORY NOTES)
+#if REVERB_PACKED
+#define REVERB_BUFFER_SIZE ((REVERB_WORDS * 2 / 5) * 4)          // Reverb samples that fit (4912 packed 4 to every 5 bytes, See kernel.h)
+#else
+#define REVERB_BUFFER_SIZE REVERB_WORDS                          // Reverb samples that fit (one per word)
+#endif
+#define ARENA_SIZE         (BUFFER_SIZE*2 + REVERB_WORDS)        // Words in the arena (enough for the audio layout: input + morph + reverb)
+#define CV_LOOP_SIZE       (ARENA_SIZE / 2)                      // CV mode has no reverb, so input & morph split the whole arena (1792 words each)
+#define CV_LOOP_STEPS      (CV_LOOP_SIZE * 2 / sizeof(KernelCVCell)) // CV loop steps that fit in CV_LOOP_SIZE words (3584)
+#define AUDIO_LOOP_SIZE    (BUFFER_SIZE * 2 / sizeof(KernelLoopCell)) // Audio loop samples that fit in BUFFER_SIZE words (512 with LOOP_MULAW)
+
+uint16_t  arena[ARENA_SIZE];                                     // Shared by input_buffer, morph_buffer & reverb_buffer (See DSP::layoutArena)
+uint16_t *input_buffer  = arena;                                 // Stores the input from the audio in
+uint16_t *morph_buffer  = arena + BUFFER_SIZE;                   // Stores the morph state
+KernelLoopCell *audio_input = (KernelLoopCell *)arena;           // The same two buffers as audio mode sees them (mu-law codes with LOOP_MULAW, See kernel.h)
+KernelLoopCell *audio_morph = (KernelLoopCell *)arena + AUDIO_LOOP_SIZE;
+KernelCVCell   *cv_input    = (KernelCVCell *)arena;             // and as CV mode sees them (one note per step)
+KernelCVCell   *cv_morph    = (KernelCVCell *)arena + CV_LOOP_STEPS;
+KernelReverbCell *reverb_buffer = (KernelReverbCell *)(arena + BUFFER_SIZE * 2); // Reverb buffer that keeps track of the sample history
+uint16_t  loop_capacity = BUFFER_SIZE;                           // Entries in input_buffer & morph_buffer (the longest loop the layout allows)
+uint16_t  output_buffer[BUFFER_SIZE]={0x200};                    // Stores the information to display on the screen
+uint8_t   scope_shift   = 0;                                     // A loop keeps every 2^scope_shift-th sample in output_buffer (See scopeShift)
+
+struct ArenaLayout {
+  uint16_t loop_size;                                            // Words in input_buffer & morph_buffer
+  uint16_t reverb_size;                                          // Samples in reverb_buffer (0 for the modes that never run the reverb)
+  uint16_t rest;                                                 // Value everything gets cleared to (the middle for audio, 0v for CV)
+  uint8_t  cells;                                                // What the loop buffers hold (ARENA_RAW, ARENA_AUDIO or ARENA_CV)
+};
 
-#define BUFFER_SIZE    256                                       // Using 256 instead of 240 so the 8-bit pointer can just roll over on its own
-uint16_t input_buffer[BUFFER_SIZE]={0x200};                      // Stores the input from the audio in
-uint16_t output_buffer[BUFFER_SIZE]={0x200};                     // Stores the information to display on the screen
-uint16_t morph_buffer[BUFFER_SIZE]={0x200};                      // Stores the morph state
+#define ARENA_RAW   0                                            // Raw 16-bit readings (input_buffer & morph_buffer)
+#define ARENA_AUDIO 1                                            // KernelLoopCells (audio_input & audio_morph)
+#define ARENA_CV    2                                            // KernelCVCells (cv_input & cv_morph)
 
-volatile uint16_t bitcrush_conversion[1024] = {0x200};           // Array that holds the bitcrush conversion table for the current bitcrush setting
+const ArenaLayout ARENA_LAYOUT[4] PROGMEM_MAPPED = {             // One per mode (MODE_IDLE, MODE_AUDIO, MODE_CV, MODE_CAL)
+  { BUFFER_SIZE,  REVERB_BUFFER_SIZE, 0x200, ARENA_AUDIO },      // Idle is the same as audio, so the layout at boot is ready to go
+  { BUFFER_SIZE,  REVERB_BUFFER_SIZE, 0x200, ARENA_AUDIO },      // Audio: loop & morph buffers plus the full reverb
+  { CV_LOOP_SIZE, 0,                  0x000, ARENA_CV    },      // CV: no reverb, so the whole arena goes to the step sequence
+  { BUFFER_SIZE,  0,                  0x200, ARENA_RAW   },      // Callibration: just the input history calMeasure reads
+};
 
+// Loops can be longer than output_buffer, so the kernels store a loop sample at loop_pointer >> scope_shift. This is the
+// smallest shift that fits a loop of len samples into the BUFFER_SIZE entries (0 up to 256, 1 up to 512 ... 4 for 3584)
+inline uint8_t scopeShift( uint16_t len ){
+  uint8_t shift = 0;
+  while( (uint16_t(BUFFER_SIZE) << shift) < len ) shift++;
+  return shift;
+}
 
-#define REVERB_BUFFER_SIZE 2048                                  // Size of the reverb buffer. Any bigger and we are going to run out of memory!
-uint16_t reverb_buffer[ REVERB_BUFFER_SIZE ]={0x200};            // Reverb buffer that keeps track of the sample history
+// BITCRUSH TABLE NOTES:
+// • There are two bitcrush tables. The ISR reads the front one (kernel_params.bitcrush) while loop() rebuilds the back one a
+//   chunk at a time (See DSP::buildBitCrush), so sweeping the crush knob never stalls loop() for a whole 1024 entry rebuild.
+// • Once the back table is done, the pointer gets swapped with the interrupts off, so the ISR never reads a half-built table.
+// • With BITCRUSH_TABLE set to false there are no tables at all and the kernel works the crush out on every sample instead.
 
-#define SAMPLE_RATE_CONVERSION_SIZE 1024                         // Pre-calculated sample rate conversion table that converts the linear pot input
-uint16_t sample_rate_conversion[SAMPLE_RATE_CONVERSION_SIZE]={0};// into the sample period that determines the ISR period
+#define BITCRUSH_CHUNK 128                                       // Bitcrush table entries rebuilt per DSP::process() call (8 calls per table)
+#if BITCRUSH_TABLE
+uint16_t bitcrush_tables[2][KERNEL_BITCRUSH_SIZE];              // Front & back bitcrush conversion tables for the current bitcrush setting
+#endif
 
 #define CALLIBRATION_OFFSET 12                                   // Offset variable for callibrating the output of the module
 
+uint16_t note_dac[KERNEL_NOTES];                                 // Calibrated DAC0.DATA value for each CV note (See DSP::loadCalibration)
+KernelInputCal input_cal = { 0, 4096 };                          // Audio input offset & gain correction, folded into the bitcrush tables (See DSP::calibrateInput)
+
 
 /*******************************************
 * DSP Properties / Settings                *
 *******************************************/
 
-volatile uint16_t input_index  = 0;                             // Points to the next byte to overwrite in the input buffer
-volatile uint16_t output_index = 0;                             // Points to the next byte to overwrite in the output buffer
-
-volatile uint16_t rolling_avg  = 0x200;                         // Rolling average of bitCrush(sampleCrush(input)) - set it to the middle value to start
-volatile uint16_t rolling_avg2 = 0x200;                         // Rolling average of bitCrush(sampleCrush(input)) - set it to the middle value to start
-volatile uint16_t rolling_avg3 = 0x200;                         // Rolling average of bitCrush(sampleCrush(input)) - set it to the middle value to start
-volatile uint16_t rolling_avg4 = 0x200;                         // Rolling average of bitCrush(sampleCrush(input)) - set it to the middle value to start
-volatile uint16_t rolling_avg5 = 0x200;                         // Rolling average of bitCrush(sampleCrush(input)) - set it to the middle value to start
-volatile uint8_t  resonance = 0;
-
-volatile uint16_t glide         = 0;                            // Filter setting in CV mode that adjusts how quickly a note can change to match the input voltage
-volatile uint16_t alpha         = 128;                          // Pre-calculated filter weight: cutoff / ( (sampleRate/(2*Pi)) + cutOff) * 255
-volatile uint16_t sample_rate   = 1023;                         // Tracks the current sample rate setting
-volatile int16_t  scale_crush   = 0;                            // Holds the current value of the scale_crush setting used in CV mode
-
-volatile uint16_t loop_length   = 0;                            // Length of the loop
-volatile uint16_t loop_pointer  = 0;                            // Current sample in the loop to play 
-volatile uint8_t  morph_rate    = 4;                            // Rate that new samples get captured and morphed into
-volatile uint32_t morph_counter = 16;                           // Percentage of the way through the current morph cycle
-
-volatile uint16_t reverb_read_index    = 0;                     // Current read position within the reverb buffer
-volatile uint16_t reverb_write_index   = REVERB_BUFFER_SIZE-1;  // Current write position within the reverb buffer
-volatile uint16_t reverb_delay         = REVERB_BUFFER_SIZE-1;  // The number of buffer elements between the read and write pointers
-volatile uint8_t  reverb_feedback      = 16;                    // Percentage mix of feedback (out of 256)
-volatile uint8_t  reverb_wet_mix       = 128;                   // Percentage mix of original signal (out of 256)
-
-volatile uint8_t  note_offset = 0;                              // The amount to offset the notes by (transposition)
-volatile uint8_t  scale_index = 0;                              // This is the current scale that notes are being quantized to
-
-volatile bool     skip_ISR = false;                             // Flag that is turned on while in the ISR to prevent the ISR from running again
-volatile uint8_t  ISR_period = 1;                               // Counter that drops the ISR down by a number of octaves - 1: 0 Oct, 2: 1 Oct, 4: 2 Oct, 8: 4 Oct, 16: 5 Oct ... 
-volatile uint8_t  ISR_counter = ISR_period;                     // The ISR counts down the counter from period and resets
+// DSP STATE NOTES:
+// • Everything the sample kernels carry from one sample to the next lives in dsp_state. It is deliberately NOT volatile. Each kernel
+//   copies it into a local on the way in and writes it back once on the way out, so avr-gcc can keep it in registers for the whole
+//   sample instead of reloading and re-storing every field on every access.
+// • loop() never touches dsp_state directly. Settings go in (and positions come out) through the DSP class accessors, which turn
+//   the interrupts off for the copy so the ISR never sees a half-written 16-bit value.
+
+#define CV_CLOCK_DIVIDER 128                                    // This is the clock divider count for the CV mode. 
+
+struct DSPState {
+  uint8_t  input_index;                                         // Points to the next byte to overwrite in the input buffer
+  uint8_t  output_index;                                        // Points to the next byte to overwrite in the output buffer
+  uint16_t loop_length;                                         // Length of the loop
+  uint16_t loop_pointer;                                        // Current sample in the loop to play 
+  uint16_t loop_frac;                                           // How far past loop_pointer the audio loop's read pointer is (out of 65536, See kernel.h)
+  uint32_t loop_step;                                           // How far the audio loop's read pointer moves every sample (16.16, 0x10000 is the recorded pitch)
+  uint8_t  morph_rate;                                          // Rate that new samples get captured and morphed into
+  uint16_t morph_counter;                                       // Percentage of the way through the current morph cycle
+  uint16_t morph_weight;                                        // Weight of the morph_buffer, slewing toward the current grain's (0...255 << 7, See kernel.h)
+  uint16_t grain_end;                                           // Loop position where the next grain slot starts
+  uint16_t grain_length;                                        // Samples in each grain slot (loop_length / MORPH_GRAINS, set by DSP::setLoopLength)
+  uint8_t  grain;                                               // Grain slot the loop pointer is in
+  uint32_t phase;                                               // Sample rate phase accumulator. A new sample gets taken every time it rolls over (See kernel.h)
+  uint32_t phase_inc;                                           // Amount added to phase on every ISR tick in audio mode (set by the Rate knob)
+  uint32_t cv_phase_inc;                                        // Amount added on every tick in CV mode (phase_inc / CV_CLOCK_DIVIDER)
+  uint8_t  clock_divider;                                       // clock_divider counts down from CV_CLOCK_DIVIDER to decide when to step in calibration mode
+};
+DSPState dsp_state = { 0, 0, 0, 0, 0, 0x10000, 4, 16, 0, 1, 1, 0, 0, 0xFFFFFFFF, 0x01FFFFFF, 1 }; // input_index, output_index, loop_length, loop_pointer, loop_frac, loop_step, morph_rate, morph_counter, morph_weight, grain_end, grain_length, grain, phase, phase_inc, cv_phase_inc, clock_divider
+uint8_t  morph_grains[MORPH_GRAINS];                            // Weight of the morph_buffer in each grain slot for this loop cycle (See kernelMorphGrains)
+
+uint16_t sample_rate = 1023;                                    // Tracks the current sample rate setting (only used by loop())
+
+KernelParams kernel_params = {                                  // Settings used by the per-sample kernel functions (see kernel.h)
+#if BITCRUSH_TABLE
+  bitcrush_tables[0], note_dac,                                 // bitcrush table, note -> DAC table
+#else
+  NULL, note_dac,
+#endif
+  (KernelReverbCell *)(arena + BUFFER_SIZE * 2), REVERB_BUFFER_SIZE, // reverb buffer and its size (the audio layout, See ARENA_LAYOUT)
+  REVERB_BUFFER_SIZE-1, 16, 128,                                // reverb_delay, reverb_feedback, reverb_wet_mix
+  0, 128, 0, 0, 0, 0                                            // resonance, alpha, glide, scale_crush, scale_index, note_offset
+};
+KernelState  kernel_state;                                      // Filter, glide & reverb history carried between samples by the kernel
 
-volatile uint8_t  dsp_mode = 0;                                 // 0 - Off, 1 - Audio mode; 2 - CV mode;
+bool     skip_ISR = false;                                      // Flag that is turned on while in the ISR to prevent the ISR from running again
 
-#define SCALE_PROB_RANGE 250                                    // Determines the randomization of the scale thresholds for weighted scales
-volatile uint8_t prob_map[12] = {0};                            // Holds the current weighted thresholds for the keys for quantizing 
-volatile uint8_t note_scale   = 0;                              // The output note
-volatile uint8_t note_oct     = 0;                              // The output octave
+uint8_t  dsp_mode = 0;                                          // 0 - Off, 1 - Audio mode; 2 - CV mode; (the ISR follows sample_kernel, not this)
 
 bool trigger_mode = false;                                      // Trigger_mode sets the mode of the ISR so that it only advances when trigger_gate is true
-bool trigger_gate = false;                                      // When trigger gate is true, the ISR will execute once and then stop (if trigger_mode is true)
-bool pause_ISR    = false;                                      // Tracks when the ISR is paused
-
-#define CV_CLOCK_DIVIDER 128;                                   // This is the clock divider count for the CV mode. 
-volatile uint16_t clock_divider = 1;                            // clock_divider counts down from CV_CLOCK_DIVIDER to decide when to execute the ISR in CV mode
-
-volatile uint32_t frame_period = 0;                             // Keeps track of the time to render a sample in the ISR. Currently it takes about 60 uS. At 70, things get real laggy
+bool trigger_gate = false;                                      // Tracks the state of the gate so each rising edge steps the quantizer exactly once
 
+uint16_t frame_period = 0;                                      // TCA0 ticks from the timer overflow to the end of the ISR. Used to be about 60 uS. At 70, things get real laggy
 
 //Mode Definitions:
 #define MODE_IDLE  0                                            // In idle mode, the output just sits at 0x200
@@ -135,415 +209,529 @@ volatile uint32_t frame_period = 0;                             // Keeps track o
 #define MODE_CAL   3                                            // DSP goes into calibration mode so you can center the output voltage
 
 
-// TWEEN FUNCTION NOTES
-// • The tween array is a pre-calculated function that provides a smooth "S-curve" transition that eases in and eases out
-// • This conversion is used to transition smoothly from one input "grain" to the next in the morph function
-
-uint8_t TWEEN_FN[257] = {
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x01,0x01,0x02,0x02,
-0x02,0x03,0x03,0x04,0x04,0x04,0x05,0x05,0x06,0x06,0x07,0x07,0x08,0x09,0x09,0x0A,
-0x0B,0x0B,0x0C,0x0D,0x0D,0x0E,0x0F,0x10,0x10,0x11,0x12,0x13,0x14,0x15,0x15,0x16,
-0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,0x20,0x21,0x22,0x23,0x24,0x25,0x27,
-0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2F,0x30,0x31,0x32,0x33,0x35,0x36,0x37,0x38,0x3A,
-0x3B,0x3C,0x3E,0x3F,0x40,0x42,0x43,0x44,0x46,0x47,0x48,0x4A,0x4B,0x4D,0x4E,0x4F,
-0x51,0x52,0x54,0x55,0x56,0x58,0x59,0x5B,0x5C,0x5E,0x5F,0x61,0x62,0x63,0x65,0x66,
-0x68,0x69,0x6B,0x6C,0x6E,0x6F,0x71,0x72,0x74,0x75,0x77,0x78,0x7A,0x7B,0x7D,0x7E,
-0x80,0x81,0x83,0x84,0x86,0x87,0x89,0x8A,0x8C,0x8D,0x8F,0x90,0x92,0x93,0x95,0x96,
-0x98,0x99,0x9B,0x9C,0x9D,0x9F,0xA0,0xA2,0xA3,0xA5,0xA6,0xA8,0xA9,0xAA,0xAC,0xAD,
-0xAF,0xB0,0xB1,0xB3,0xB4,0xB6,0xB7,0xB8,0xBA,0xBB,0xBC,0xBE,0xBF,0xC0,0xC2,0xC3,
-0xC4,0xC6,0xC7,0xC8,0xC9,0xCB,0xCC,0xCD,0xCE,0xCF,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,
-0xD7,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,
-0xE8,0xE9,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEE,0xEF,0xF0,0xF1,0xF1,0xF2,0xF3,0xF3,
-0xF4,0xF5,0xF5,0xF6,0xF7,0xF7,0xF8,0xF8,0xF9,0xF9,0xFA,0xFA,0xFA,0xFB,0xFB,0xFC,
-0xFC,0xFC,0xFD,0xFD,0xFD,0xFD,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFF, 0xFF 
-};
-
-
-/* various other tween functions where dist goes from 0 to 63, or 0 to 127. In the end I used 0 to 255
-#define TWEEN( v1, v2, dist, max ){ int16_t((((int32_t(v2)-int32_t(v1)) * (dist)) / (max)) + (v1)) }
-#define TWEEN64(  v1, v2, dist ){ uint16_t( ( uint32_t(v2) * uint8_t(dist) + uint32_t(v1) * (  63-uint8_t(dist) ) ) >> 6 ) }
-#define TWEEN128( v1, v2, dist ){ uint16_t( ( uint32_t(v2) * uint8_t(dist) + uint32_t(v1) * ( 127-uint8_t(dist) ) ) >> 7 ) }
-*/
-// TWEEN256_POS takes a weighted average between v1 and v2 when v2 > v1
-#define TWEEN256_POS( v1, v2, dist ) ( uint16_t(v1) + uint16_t((uint32_t(uint16_t(v2)-uint16_t(v1)) * uint32_t(dist)) >> 8) )
-
-// TWEEN256_NEG takes a weighted average between v1 and v2 when v1 > v2
-#define TWEEN256_NEG( v1, v2, dist ) ( uint16_t(v1) - uint16_t((uint32_t(uint16_t(v1)-uint16_t(v2)) * uint32_t(dist)) >> 8) )
+/*******************************************
+* Block Engine                             *
+*******************************************/
 
-// TWEEN256 figures out which POS/NEG function to use to take a weighted average between v1 and v2
-#define TWEEN256( v1, v2, dist )     ( ( uint16_t(v2)>uint16_t(v1) ) ? TWEEN256_POS(v1,v2,dist) : TWEEN256_NEG(v1,v2,dist) )
+// With the block engine turned on, audio mode stops rendering samples inside the ISR. Instead, the ISR pushes raw ADC
+// readings into adc_ring and pops finished samples out of dac_ring, while DSP::process() (called from loop()) drains
+// adc_ring through the filter & reverb in a batch and refills dac_ring. Each ring has exactly one writer for each index
+// and the indices are 8-bits, so they can be updated without ever turning the interrupts off. CV and callibration modes
+// still run per-sample in the ISR since the ring would add way too much latency to a quantizer.
+//
+// BLOCK ENGINE NOTES:
+// • dac_ring has to last through the longest stretch of loop() between two process() calls. One sample goes out every
+//   BLOCK_MIN_SAMPLE_PERIOD / 25 MHz = 60 uS, so the RING_PRIME headroom is 192 x 60 uS = 11.5 mS.
+// • A whole frame to the screen is about 1092 bytes on the bus, or about 25 mS at 400 kHz, so it would drain the ring on
+//   every update. That's why loop() sends the frame a chunk at a time and calls process() after every chunk (See DISPLAY
+//   NOTES in hardware.h). A chunk is about 0.75 mS. The longest gap left is the drawing and the event handling, which is
+//   what underruns (shown in full-screen audio mode) keeps an eye on.
+// • Bigger rings aren't an option: covering a whole frame would take 512 entry rings (2 kB more RAM), and that doesn't
+//   fit next to the arena (See MEMORY NOTES).
+#define BLOCK_ENGINE false                                      // Set to true to render audio in loop() instead of in the ISR (See BLOCK ENGINE NOTES)
+
+#define RING_SIZE               256                             // 256 so that the 8-bit ring indices just roll over on their own
+#define RING_PRIME              192                             // Samples of silence loaded into dac_ring when audio mode starts. This is the latency (and the headroom for loop())
+#define BLOCK_MIN_SAMPLE_PERIOD 1500                            // Shortest ISR period with the block engine. The ISR is tiny now, but loop() still has to keep up on average
+#define ISR_MIN_SAMPLE_PERIOD   2000                            // Shortest ISR period when everything is rendered in the ISR
+
+#if BLOCK_ENGINE                                                // TCA0 always ticks at the top sample rate. The Rate knob only
+#define ISR_TICK_PERIOD BLOCK_MIN_SAMPLE_PERIOD                 // changes how often the phase accumulator takes a new sample
+#else                                                           // (See SAMPLE RATE NOTES in kernel.h)
+#define ISR_TICK_PERIOD ISR_MIN_SAMPLE_PERIOD
+#endif
+
+constexpr KernelPhaseTable PHASE_INC PROGMEM_MAPPED = KernelPhaseTable( ISR_TICK_PERIOD ); // Phase increment for each pitch in the bottom octave
+constexpr KernelLoopPitchTable LOOP_PITCH PROGMEM_MAPPED;       // loop_step for each Loop Pitch setting
+
+#if BLOCK_ENGINE
+volatile uint16_t adc_ring[RING_SIZE];                          // Raw audio input readings waiting to be rendered (ISR writes, loop() reads)
+volatile uint16_t dac_ring[RING_SIZE];                          // Rendered samples waiting to go out the DAC (loop() writes, ISR reads)
+volatile uint8_t  adc_head = 0;                                 // Next slot the ISR writes in adc_ring
+volatile uint8_t  adc_tail = 0;                                 // Next slot loop() reads from adc_ring
+volatile uint8_t  dac_head = 0;                                 // Next slot loop() writes in dac_ring
+volatile uint8_t  dac_tail = 0;                                 // Next slot the ISR reads from dac_ring
+#endif
+volatile uint16_t underruns = 0;                                // Number of times the ISR found dac_ring empty (i.e. loop() didn't keep up)
 
 
 /*******************************************
-* QUANTIZING DEFINITIONS                   *
+* DAC Output                               *
 *******************************************/
-// Scale Probabilities
-#define UNITS_PER_NOTE (1024/120)
-
-int16_t SCALE_PROB[22][12] = {
-/*  C    C#   D    D#   E    F    F#   G    G#   A    A#   B */
-  { 635, 635, 635, 635, 635, 635, 635, 635, 635, 635, 635, 635 }, // Chromatic
-  { 635,   0, 635,   0, 635, 635,   0, 635,   0, 635,   0, 635 }, // Major Quantized
-  { 635, 223, 348, 233, 438, 409, 252, 519, 239, 366, 229, 288 }, // Major Weighted
-  { 635,   0, 635, 635,   0, 635,   0, 635, 635,   0, 635,   0 }, // Minor Quantized
-  { 635, 268, 352, 538, 260, 353, 254, 475, 398, 259, 334, 317 }, // Minor Weighted
-  { 635,   0,   0, 635,   0,   0, 635,   0,   0, 635,   0,   0 }, // Diminished
-  { 635,   0, 635,   0, 635,   0, 635,   0, 635,   0, 635,   0 }, // Whole Tone
-  { 635,   0, 635, 635,   0, 635,   0, 635,   0, 635, 635,   0 }, // Dorian
-  { 635,   0,   0, 635,   0, 635, 635, 635,   0,   0, 635,   0 }, // Blues
-  { 635,   0, 635,   0, 635, 635,   0, 635,   0, 635, 635,   0 }, // Mixolydian
-  { 635,   0, 635, 635,   0,   0, 635, 635, 635,   0,   0, 635 }, // Hungarian
-  { 635,   0,   0, 635,   0, 635,   0, 635,   0,   0, 635,   0 }, // Pentatonic
-//{ 635,   0, 635, 635,   0, 635,   0, 635,   0, 635,   0, 635 }, // Melodic Minor
-  { 635,   0, 352, 538,   0, 353,   0, 475,   0, 500,   0, 475 }, // Melodic Minor (Weighted)
-  { 635,   0, 635,   0, 635, 635, 635,   0, 635,   0, 635,   0 }, // Arabian
-  { 635, 635,   0, 635,   0,   0,   0, 635, 635,   0,   0,   0 }, // Balinese
-  { 635, 635,   0,   0, 635, 635,   0, 635, 635,   0, 635,   0 }, // Spanish Gypsy
-  { 635, 635,   0,   0, 635, 635, 635,   0,   0, 635, 635,   0 }, // Oriental
-  { 635,   0, 635,   0, 635,   0, 635,   0,   0, 635, 635,   0 }, // Prometheus
-  { 635, 635,   0,   0,   0, 635,   0, 635,   0,   0, 635,   0 }, // Japanese
-  { 635,   0, 635,   0,   0, 635,   0, 635,   0,   0, 635,   0 }, // Egyptian
-  { 635, 635,   0,   0, 635, 635,   0, 635,   0,   0, 635,   0 }, // Iberian
-  { 635,   0, 635, 635,   0,   0, 635, 635,   0, 635, 635,   0 }  // Romanian
-};
 
+// OUTPUT NOTES:
+// • With OUTPUT_FIRST on, the kernels don't write DAC0.DATA themselves. They leave the sample in dac_next and the ISR
+//   writes it as the very first thing on the next tick. That costs one tick of latency, but the output always changes
+//   the same number of cycles after the timer edge no matter which path the kernel took or how long it ran.
+// • Every DAC write gets time stamped with TCA0.SINGLE.CNT (ticks since the timer edge) so the spread between the
+//   earliest and latest write can be checked with DSP::getDacJitter(). With OUTPUT_FIRST it should be a few ticks.
+// • DSP::getBootTime() says how long a cold start takes: it's millis() at the very end of DSP::setup(), once the bitcrush
+//   table is built and the settings are in, so the next tick plays a real sample. The ISR idles on the midpoint before
+//   that, so its first DAC write would leave out the table work. millis() starts counting in the core's init(), which is
+//   only a few uS after reset.
+
+#define OUTPUT_FIRST true                                       // Set to false to write the DAC as soon as each sample is computed
+#define TIMING_PROBES false                                     // Set to true to show the timing measurements down the side of the full screen scope
+
+uint16_t dac_next       = 0x8000;                               // Sample waiting to go out on the next tick (left aligned, like DAC0.DATA)
+uint16_t dac_jitter_min = 0xFFFF;                               // Earliest DAC write seen (in TCA0 ticks after the timer edge)
+uint16_t dac_jitter_max = 0;                                    // Latest DAC write seen (in TCA0 ticks after the timer edge)
+uint16_t boot_ms        = 0xFFFF;                               // millis() when DSP::setup finished (See getBootTime)
+
+// Records when the DAC was just written relative to the timer edge
+inline void dacStamp(){
+  uint16_t t = TCA0.SINGLE.CNT;
+  if( t < dac_jitter_min ) dac_jitter_min = t;
+  if( t > dac_jitter_max ) dac_jitter_max = t;
+}
+
+// Hands a left aligned sample to the DAC (or queues it up for the next tick with OUTPUT_FIRST)
+inline void dacWrite( uint16_t data ){
+#if OUTPUT_FIRST
+  dac_next = data;
+#else
+  DAC0.DATA = data;
+  dacStamp();
+#endif
+}
 
 
 /*******************************************
-* MAIN ISR PROCESSING FUNCTION             *
+* Sample Kernels                           *
 *******************************************/
 
-ISR(TCA0_OVF_vect) {
+// KERNEL NOTES:
+// • Rather than checking dsp_mode, trigger_mode, loop_length and morph_rate on every single sample, each combination gets
+//   its own compile-time specialized kernel. DSP::selectKernel() picks the right one whenever one of those settings changes
+//   and the ISR just calls whatever sample_kernel points to.
+// • LOOP is true when loop_length > 0. The morph weights only change once per loop cycle (See loopAdvance), so the
+//   morph_rate doesn't need a kernel of its own.
+// • Every kernel is a separate function, so each one can be profiled on its own with frame_period.
+
+typedef void (*SampleKernel)();                                 // Signature of the per-sample kernels called by the ISR
+typedef uint16_t (*AudioRenderer)( DSPState &st, KernelState &ks, uint16_t val ); // Signature of the audio renderers used by the ISR and DSP::process()
+
+// STATE NOTES:
+// • dsp_state is 16 fields (35 bytes on the AVR). Copying all of it into st and back on every tick would be 35 loads and
+//   35 stores, and most of them move fields the kernel never looks at. So each kernel only loads the fields it uses, and
+//   only stores back the ones it moves:
+//   - The live kernels (audio, CV & callibration) just move the buffer indices: 2 bytes in and 2 out (liveLoad).
+//   - The CV loop loads the loop & grain fields and stores the 6 bytes that move: 12 in and 6 out (loopLoad).
+//   - The audio loop also needs the read pointer's fraction & step and the morph weight: 20 in and 11 out (audioLoopLoad).
+//   loop_length, loop_step, morph_rate and grain_length are only ever changed by loop() (with the interrupts off), so
+//   the kernels never store them.
+// • The phase accumulator and clock_divider don't go through st at all, the kernels step them right in dsp_state.
+// • The rest of st is left uninitialized, so anything a kernel reads from st has to be in its load.
+// • kernel_state gets the same treatment. The filter & reverb fields (32 bytes) all move on every audio sample, so the
+//   audio kernels load them into ks and store them all back (audioStateLoad). The CV kernels only load the 6 bytes of
+//   glide, scale mask and rng (cvStateLoad), and only when they step. Besides the loads & stores, a local that never
+//   leaves the kernel can't be overwritten by a store into one of the buffers, so the compiler can keep the fields in
+//   registers across the buffer writes instead of reading them back from RAM after every one.
+
+inline void liveLoad( DSPState &st ){
+  st.input_index  = dsp_state.input_index;
+  st.output_index = dsp_state.output_index;
+}
+inline void liveStore( const DSPState &st ){
+  dsp_state.input_index  = st.input_index;
+  dsp_state.output_index = st.output_index;
+}
+inline void loopLoad( DSPState &st ){
+  st.loop_length   = dsp_state.loop_length;
+  st.loop_pointer  = dsp_state.loop_pointer;
+  st.morph_rate    = dsp_state.morph_rate;
+  st.morph_counter = dsp_state.morph_counter;
+  st.grain_end     = dsp_state.grain_end;
+  st.grain_length  = dsp_state.grain_length;
+  st.grain         = dsp_state.grain;
+}
+inline void loopStore( const DSPState &st ){
+  dsp_state.loop_pointer  = st.loop_pointer;
+  dsp_state.morph_counter = st.morph_counter;
+  dsp_state.grain_end     = st.grain_end;
+  dsp_state.grain         = st.grain;
+}
+inline void audioLoopLoad( DSPState &st ){
+  loopLoad( st );
+  st.loop_frac    = dsp_state.loop_frac;
+  st.loop_step    = dsp_state.loop_step;
+  st.morph_weight = dsp_state.morph_weight;
+}
+inline void audioLoopStore( const DSPState &st ){
+  loopStore( st );
+  dsp_state.loop_frac    = st.loop_frac;
+  dsp_state.morph_weight = st.morph_weight;
+}
 
-  // --- TRIGGER DETECTION --- //
-  if( (dsp_mode == MODE_CV) && trigger_mode ){                                 // If we are in dsp_mode and trigger_mode is set
-    if( analogRead( PIN_CV_SR ) > 50 ){                                        // Then check if the sample rate CV pin is not zero
-      if( trigger_gate == false ){                                             // And if trigger_gate was currently false
-        trigger_gate = true;                                                   // then turn trigger_gate on (so we don't retrigger the gate again)
-        pause_ISR = false;                                                     // and un-pause the ISR
-      }
-    } else {                                                                   // Otherwise if analog read is zero, then set trigger_gate to false
-      trigger_gate = false;                                                    // then set trigger_gate to false
-    }
-    if( pause_ISR ){                                                           // If we need to pause the ISR then
-      TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;                                // reset the interrupt vector
-      return;                                                                  // and return out of the ISR function
-    }
-    clock_divider = 1;                                                         // Otherwise, set the clock_divider to 1 so the CV function doesn't sub-divide 
-    pause_ISR = true;                                                          // Re-pause the ISR for the next run through the loop
+inline void audioStateLoad( KernelState &ks ){
+  ks.rolling_avg  = kernel_state.rolling_avg;
+  ks.rolling_avg2 = kernel_state.rolling_avg2;
+  ks.rolling_avg3 = kernel_state.rolling_avg3;
+  ks.rolling_avg4 = kernel_state.rolling_avg4;
+  ks.rolling_avg5 = kernel_state.rolling_avg5;
+  ks.reverb_write_index = kernel_state.reverb_write_index;
+  ks.reverb_ap_index[0] = kernel_state.reverb_ap_index[0];
+  ks.reverb_ap_index[1] = kernel_state.reverb_ap_index[1];
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ) ks.reverb_head[k] = kernel_state.reverb_head[k];
+}
+inline void audioStateStore( const KernelState &ks ){
+  kernel_state.rolling_avg  = ks.rolling_avg;
+  kernel_state.rolling_avg2 = ks.rolling_avg2;
+  kernel_state.rolling_avg3 = ks.rolling_avg3;
+  kernel_state.rolling_avg4 = ks.rolling_avg4;
+  kernel_state.rolling_avg5 = ks.rolling_avg5;
+  kernel_state.reverb_write_index = ks.reverb_write_index;
+  kernel_state.reverb_ap_index[0] = ks.reverb_ap_index[0];
+  kernel_state.reverb_ap_index[1] = ks.reverb_ap_index[1];
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ) kernel_state.reverb_head[k] = ks.reverb_head[k];
+}
+inline void cvStateLoad( KernelState &ks ){
+  ks.glide_avg  = kernel_state.glide_avg;
+  ks.scale_mask = kernel_state.scale_mask;
+  ks.rng        = kernel_state.rng;
+}
+inline void cvStateStore( const KernelState &ks ){
+  kernel_state.glide_avg  = ks.glide_avg;
+  kernel_state.scale_mask = ks.scale_mask;
+  kernel_state.rng        = ks.rng;
+}
+
+// Moves the loop pointer on by one step. At the end of the loop it wraps around, ticks the morph_counter and works out the
+// grain weights for the next cycle. Otherwise it just keeps track of which grain slot the pointer is in (See kernel.h)
+inline void loopAdvance( DSPState &st ){
+  if( ++st.loop_pointer >= st.loop_length ){                                   // Track progress through the loop, and once we hit the end of the loop
+    st.loop_pointer = 0;                                                       // Reset the loop pointer to zero and
+    if( st.morph_counter--==0 ) st.morph_counter = uint16_t(1)<<st.morph_rate; // if morph_counter also hit zero, reset it to count down from 2^morph_rate 
+    kernelMorphGrains( morph_grains, st.morph_counter, st.morph_rate );        // The only place the weights change, so work them out once per cycle
+    st.grain     = 0;                                                          // and start over at the first grain
+    st.grain_end = st.grain_length;
+  } else if( st.loop_pointer >= st.grain_end && st.grain < MORPH_GRAINS - 1 ){ // Crossed into the next grain (the last one runs to the end of the loop)
+    st.grain++;
+    st.grain_end += st.grain_length;
   }
+}
 
-  // --- ISR SPEED LIMIT --- //
-  if( skip_ISR ){                                                              // If the ISR tries to run again while the current ISR is running, well, that's bad.
-    TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;                                  // If skip_ISR is true, then reset the ISR vector
-    return;                                                                    // and return out of the ISR function
+// Takes the next audio input reading and returns the sample to send to the DAC. This gets called straight from the
+// audio kernel normally, or from DSP::process() when the block engine is turned on. Either way, it only ever runs in one place.
+template<bool LOOP>
+inline uint16_t renderAudioSample( DSPState &st, KernelState &ks, uint16_t val ){
+  if( !LOOP ){
+
+
+    // ----------------------- //
+    //    NORMAL AUDIO MODE
+    // ----------------------- //
+
+    // NORMAL BIT CRUSH NOTES:
+    uint16_t crushed = kernelBitCrush( kernel_params, val );
+    audio_input[st.input_index] = kernelLoopEncode( crushed );                 // Keep it in the input buffer in case the user flips into loop mode
+
+    // FILTER & REVERB (See kernel.h):
+    uint16_t output = kernelAudioSample( ks, kernel_params, crushed );         // (straight from the crush, so live audio never goes through the loop's mu-law)
+
+    audio_morph[st.output_index] = kernelLoopEncode( output );                 // Store output into the morph_buffer for future use if the user flips into morph mode
+    output_buffer[st.output_index] = output;                                   // Store output into the output buffer for the oscilloscope visualization
+
+    st.input_index = (st.input_index + 1) & 0xFF;                              // Increment the input pointer
+    st.output_index = (st.output_index + 1) & 0xFF;                            // Increment the output pointer
+
+    return output;
   }
-  skip_ISR = true;                                                             // Turn skip_ISR on until we get through the enormous amonunt of stuff we need to do...
 
-  uint32_t frame_start = micros();                                             // Capture the current value of micros so we can see how long it takes to render the sample
 
+  // ----------------------- //
+  //   AUDIO LOOPING MODE
+  // ----------------------- //
 
-  switch( dsp_mode ){                                                          // What we want to do depends entirely on the current mode
-    case MODE_IDLE:                                                            // If we are in Idle mode then
-      // ----------------------- //
-      //        IDLE MODE
-      // ----------------------- //
+  // SOUND MORPHING & RESAMPLING (See kernel.h):
+  uint8_t  w      = kernelMorphSlew( st.morph_weight, morph_grains[st.grain] ); // Glide the weight toward the grain the loop is in
+  uint16_t output = kernelLoopRead( audio_input, audio_morph, st.loop_pointer, st.loop_frac, st.loop_length, w );
 
-      DAC0.DATA = 0x8000;                                                      // just set the output value to the middle of the output range
-      break;                                                                   // and then bump out of the case statement
+  // BIT CRSUH
+  output = kernelBitCrush( kernel_params, output ); // bitcush the output
 
-    case MODE_AUDIO: // Audio Mode
-      if( --ISR_counter <= 0 ){                                                // See if we have gotten to zero on the counter
-        ISR_counter = ISR_period;
-        if( loop_length == 0 ){
+  // FILTER & REVERB (See kernel.h):
+  output = kernelAudioSample( ks, kernel_params, output );
 
+  output_buffer[st.loop_pointer >> scope_shift] = output;                      // Store output into the output buffer for the oscilloscope (decimated for long loops)
 
-          // ----------------------- //
-          //    NORMAL AUDIO MODE
-          // ----------------------- //
-          uint16_t val = analogRead( PIN_IN_AUD ); // Capture the initial value
 
+  // MORPH COUNTER NOTES:
+  // • Once the morph_counter reaches zero, the output_buffer gets overwritten by the input_buffer for one cycle and the input_buffer gets written into
+  // • The input is always converted by the caller (even when the morph_counter is still counting), but the ADC runs in the background so it costs nothing.
+  // • The loop pointer moves loop_step along with every sample (one whole sample at the recorded pitch). Every whole sample it
+  //   passes gets recorded (when the morph_counter is at zero) and once the loop fully cycles, it ticks the morph_counter.
+  // • When the morph_counter reaches zero, it resets based on morph_rate (See loopAdvance)
 
-          // NORMAL BIT CRUSH NOTES:
-          input_buffer[input_index] = bitcrush_conversion[val];
+  uint32_t frac = uint32_t(st.loop_frac) + st.loop_step;                       // Move the read pointer along
+  st.loop_frac  = uint16_t(frac);
+  for( uint8_t n = frac >> 16; n; n-- ){                                       // and step through each whole sample it passed
+    if( st.morph_counter == 0 ){                                               // See if the morph_counter has reached zero yet
+      audio_morph[st.loop_pointer] = audio_input[st.loop_pointer];             // If it did, then start repopulating the morph_buffer with the current input_buffer (still encoded)
+      audio_input[st.loop_pointer] = kernelLoopEncode( val );                  // And simultaneously, start overwriting the input_buffer with some new values
+    }
+    loopAdvance( st );
+  }
 
-          // LOW FREQUENCY FILTER NOTES:
-          // • The filter first takes a weighted average of the input and the inverted output (x2) from the last sample with the input to create feedback loop
-          // • The next four filter stages act like independent filter poles by taking a weighted average between the prior value and the new value.
-          // • The value of alpha is derived from the "cutoff / ( sampleRate/(2*PI) + cutoff )" formula. Since I don't really care about the exact cutoff frequency
-          //   I just use: 255 * cutoff / (128 + cutoff ) which seems to give a decent--if imprecise--filter range. 
+  return output;
+}
 
-          uint16_t output;                                                         // Create a temporary variable to keep track of the output
-/*
-          val = input_buffer[input_index] + uint16_t(0x5FF) - (rolling_avg5 << 1); // Add together the input with the inverted feedback
-          val = constrain( val, uint16_t(0x200), uint16_t(0x5FF)) - 0x200;         // Constrain the added signals and re-center
-          val = constrain( val << 2, uint16_t(0x600), uint16_t(0x9FF) ) - 0x600;   // Scale up the resonance signal by a factor of 4x and re-center
-          rolling_avg  = TWEEN256( input_buffer[input_index], val, resonance );    // Take a weighted average between the current input and the full feedback level
-*/
 
+// ----------------------- //
+//        IDLE MODE
+// ----------------------- //
+void idleKernel(){
+  dacWrite( 0x8000 );                                                          // just set the output value to the middle of the output range
+}
 
-          // FEEDBACK / RESONANCE STAGE
-          val = (input_buffer[input_index] + uint16_t(0x7FF) - (rolling_avg5 << 1)) << 2; // Add together the input with the inverted feedback
-          val = constrain( val, uint16_t(0x1600), uint16_t(0x19FF) ) - 0x1600;   // Scale up the resonance signal by a factor of 4x and re-center
-          rolling_avg  = TWEEN256( input_buffer[input_index], val, resonance );    // Take a weighted average between the current input and the full feedback level
-
-          // LOW PASS FILTER STAGES
-          rolling_avg2 = TWEEN256( rolling_avg2, rolling_avg,  alpha );        // FILTER STAGE 1
-          rolling_avg3 = TWEEN256( rolling_avg3, rolling_avg2, alpha );        // FILTER STAGE 2
-          rolling_avg4 = TWEEN256( rolling_avg4, rolling_avg3, alpha );        // Filter Stage 3
-          rolling_avg5 = TWEEN256( rolling_avg5, rolling_avg4, alpha );        // Filter Stage 4
-          output = rolling_avg5;                                               // Store this into the output variable for the reverb stage
-
-          
-          // REVERB NOTES:
-          // • reverb_buffer contains a set of 2048 output values that make up the tape loop
-          // • reverb_write_index tracks the location of the most recent value written to the buffer -- e.g. "current time"
-          //   this is effectively like the write-head on a tape loop
-          // • reverb_read_index tracks the location of the of the next value to read out of the buffer this works like
-          //   like the read head on the tape loop
-          // • First, we write a weighted average of the current sample and the sample stored at the reverb_read_index
-          //   we use the value of reverb_feedback to determine how much of the reverb sample to include vs. the rolling_avg sample
-          // • Next, we calulate an output value using a weighted average of the current sample (rolling_avg) and the sample stored 
-          //   at the reverb_read_index. The weighting of these two values is determined by reverb_wet_mix
-          // • Finally, this value is written into the output_buffer for the visualization and loop mode, and then written to DAC
-
-          val = constrain( reverb_buffer[reverb_read_index] << 1, uint16_t(0x200), uint16_t(0x5FF) ) - uint16_t(0x200);
-          reverb_buffer[reverb_write_index] = TWEEN256(output, val, reverb_feedback);
-          val = constrain( reverb_buffer[reverb_read_index] + output, uint16_t(0x200), uint16_t(0x5FF)) - uint16_t(0x200);
-          output = TWEEN256(output, val, reverb_wet_mix );
-
-          morph_buffer[output_index] = output;                                 // Store output into the morph_buffer for future use if the user flips into morph mode
-          output_buffer[output_index] = output;                                // Store output into the output buffer for the oscilloscope visualization
-
-          DAC0.DATA = output << 6;                                             // Send the output value to the DAC
-          
-          input_index = (input_index + 1) & 0xFF;                              // Increment the input pointer
-          output_index = (output_index + 1) & 0xFF;                            // Increment the output pointer
-          if( ++reverb_read_index  >= REVERB_BUFFER_SIZE ) reverb_read_index  = 0; // Increment the read pointer of the reverb loop
-          if( ++reverb_write_index >= REVERB_BUFFER_SIZE ) reverb_write_index = 0; // Increment the write pointer of the reverb loop
-
-
-
-        } else {
-
-
-          // ----------------------- //
-          //   AUDIO LOOPING MODE
-          // ----------------------- //
-
-          // SOUND MORPHING NOTES:
-          // • morph_rate is between 0 and 15 (4 bit number)
-          // • morph_counter is determined by left shifting a 1 by morph_rate and then counting down from there to zero
-          // • In order to convert morph_counter to a number consistently between 0 and 255 (to pull the correct TWEEN value)
-          //   we neeed to shift the count to the appropriate bit depth for the morph_rate. If the rate is >= 8 then the morph_counter will be at least an 
-          //   8-bit values and we right shift by (morph_rate - 8) bits so it is exactly an 8-bit value. Otherwise we left shift by (8 - morph_rate) bits.
-          // • Once we have an 8-bit value, then we can pull the corresponding value from the TWEEN_FN array and use that to choose how much to weight the
-          //   input_buffer vs. the output_buffer. 
-
-          uint16_t output;
-          if( morph_rate >= 8 ){
-            output = TWEEN256( input_buffer[loop_pointer], morph_buffer[loop_pointer], TWEEN_FN[(morph_counter >> (morph_rate - 8))] );
-          } else {
-            output = TWEEN256( input_buffer[loop_pointer], morph_buffer[loop_pointer], TWEEN_FN[(morph_counter << (8 - morph_rate))] );
-          }
-
-
-          // BIT CRSUH
-          output = bitcrush_conversion[output]; // bitcush the output
-
-
-          // LOW FREQUENCY FILTER (See Notes Above):
-          uint16_t val = (output + uint16_t(0x7FF) - (rolling_avg5 << 1)) << 2; // Add together the input with the inverted feedback
-          val = constrain( val, uint16_t(0x1600), uint16_t(0x19FF) ) - 0x1600;   // Scale up the resonance signal by a factor of 4x and re-center
-          rolling_avg  = TWEEN256( output, val, resonance );    // Take a weighted average between the current input and the full feedback level
-
-          rolling_avg2 = TWEEN256( rolling_avg2, rolling_avg,  alpha );        // FILTER STAGE 2
-          rolling_avg3 = TWEEN256( rolling_avg3, rolling_avg2, alpha );        // FILTER STAGE 2
-          rolling_avg4 = TWEEN256( rolling_avg4, rolling_avg3, alpha );        // Filter Stage 3
-          rolling_avg5 = TWEEN256( rolling_avg5, rolling_avg4, alpha );        // Filter Stage 4
-          output = rolling_avg5;                                               // Store this into the output variable for the reverb stage
-
-          // REVERB (See Notes Above):
-          val = constrain( reverb_buffer[reverb_read_index] << 1, uint16_t(0x200), uint16_t(0x5FF) ) - uint16_t(0x200);
-          reverb_buffer[reverb_write_index] = TWEEN256(output, val, reverb_feedback);
-          val = constrain( reverb_buffer[reverb_read_index] + output, uint16_t(0x200), uint16_t(0x5FF)) - uint16_t(0x200);
-          output = TWEEN256(output, val, reverb_wet_mix );
-
-          output_buffer[loop_pointer] = output;
-          DAC0.DATA = output << 6;                                             // Send the output value to the DAC
-
-
-          // MORPH COUNTER NOTES:
-          // • Once the morph_counter reaches zero, the output_buffer gets overwritten by the input_buffer for one cycle and the input_buffer gets written into
-          // • When the morph_coutner is still counting, we still exectue analogRead to maintain the same timing. Would be great if we didn't need this, but you get clicking...
-          // • The loop pointer ticks once with every ISR. Once the loop fully cycles, it ticks the morph_counter. 
-          // • When the morph_counter reaches zero, it resets based on morph_rate
-
-          if( morph_counter == 0 ){                                            // See if the morph_counter has reached zero yet
-            morph_buffer[loop_pointer] = input_buffer[loop_pointer];           // If it did, then start repopulating the morph_buffer with the current input_buffer
-            input_buffer[loop_pointer] = analogRead( PIN_IN_AUD );             // And simultaneously, start overwriting the input_buffer with some new values
-          } else {                                                             // If not, then just...
-            analogRead( PIN_IN_AUD );                                           // Read the current value of the CV input to keep the timing the same
-          }
-
-          if( ++loop_pointer >= loop_length ){                                 // Track progress through the loop, and once we hit the end of the loop
-            loop_pointer = 0;                                                  // Reset the loop pointer to zero and
-            if( morph_counter--==0 ) morph_counter = uint16_t(1)<<morph_rate;  // if morph_counter also hit zero, reset it to count down from 2^morph_rate 
-          }
-
-          if( ++reverb_read_index >= REVERB_BUFFER_SIZE ) reverb_read_index = 0;   // Increment the read pointer of the reverb loop
-          if( ++reverb_write_index >= REVERB_BUFFER_SIZE ) reverb_write_index = 0; // Increment the write pointer of the reverb loop
+
+// ----------------------- //
+//       AUDIO MODE
+// ----------------------- //
+template<bool LOOP>
+void audioKernel(){
+  uint16_t val = adcNext( adc_pipe );                                          // Grab the sample the ADC converted since the last tick and start on the next one
+  if( !kernelPhaseStep( dsp_state.phase, dsp_state.phase_inc ) ) return;       // Hold the last sample until the phase rolls over (the ADC keeps converting every tick either way)
+#if BLOCK_ENGINE
+  // ----------------------- //
+  //   BLOCK ENGINE MODE
+  // ----------------------- //
+  // The heavy lifting happens in DSP::process() from loop(), so all the ISR has to do is pop one finished
+  // sample out to the DAC and push one fresh ADC reading for the producer to pick up later.
+  if( dac_tail != dac_head ){                                                  // If the producer has a finished sample waiting for us
+    dacWrite( dac_ring[dac_tail] << 6 );                                       // send it to the DAC
+    dac_tail++;                                                                // and move along (the 8-bit index rolls over on its own)
+  } else {                                                                     // Otherwise loop() fell behind, so we just hold the last value on the DAC
+    underruns++;                                                               // and keep count so it can be watched on the screen
+  }
+  if( uint8_t(adc_head + 1) != adc_tail ){                                     // As long as the ADC ring isn't full
+    adc_ring[adc_head] = val;                                                  // hand the input sample over to loop()
+    adc_head++;
+  }
+#else
+  DSPState    st;                                                              // Copy just the fields this renderer uses into locals (See STATE NOTES)
+  KernelState ks;
+  if( LOOP ) audioLoopLoad( st ); else liveLoad( st );
+  audioStateLoad( ks );
+  dacWrite( renderAudioSample<LOOP>( st, ks, val ) << 6 );                     // Render the sample right here and send it to the DAC
+  if( LOOP ) audioLoopStore( st ); else liveStore( st );                       // and write back the ones it moved on the way out
+  audioStateStore( ks );
+#endif
+}
+
+
+// ----------------------- //
+//        CV MODE
+// ----------------------- //
+template<bool LOOP, bool TRIGGER>
+void cvKernel(){
+
+  // --- TRIGGER DETECTION --- //
+  // The ADC watches the sample rate CV pin on every tick. Once it sees a rising edge, it converts the CV input
+  // on the following tick instead, and the quantizer steps as soon as that result is ready.
+  if( TRIGGER ){                                                               // If we are in trigger_mode
+    if( adc_pipe.muxpos != MUX_IN_CV ){                                        // and we are still watching the gate
+      if( adcCollect( adc_pipe ) > 50 ){                                       // Then check if the sample rate CV pin is not zero
+        if( trigger_gate == false ){                                           // And if trigger_gate was currently false
+          trigger_gate = true;                                                 // then turn trigger_gate on (so we don't retrigger the gate again)
+          adcStart( adc_pipe, MUX_IN_CV );                                     // and go convert the CV input so we can step on the next tick
+          return;
         }
+      } else {                                                                 // Otherwise if the gate is zero, then set trigger_gate to false
+        trigger_gate = false;
       }
-      break;
+      adcStart( adc_pipe, MUX_CV_SR );                                         // Keep watching the gate
+      return;
+    }
+  } else {
 
-    case MODE_CV: // CV Mode
+    // Phase Accumulator: The CV steps CV_CLOCK_DIVIDER times slower than the audio rate, which is something more
+    // reasonable for CV tracking (cv_phase_inc is phase_inc / CV_CLOCK_DIVIDER). In trigger mode there is no
+    // need for it, since the trigger decides when to step. The CV input gets converted on every tick, so the
+    // result is always fresh when the phase rolls over.
 
-      // Clock Divider: This cuts down the frequency of the ISR to something more reasonable for CV tracking
-      // CV_CLOCK_DIVIDER determines the number of ISR ticks to wait before processing the CV
+    adcNext( adc_pipe );                                                       // Keep the CV input converting on every tick (adcCollect below still sees this result)
+    if( !kernelPhaseStep( dsp_state.phase, dsp_state.cv_phase_inc ) ) return;  // Hold the last step until the phase rolls over
+  }
 
-      if( --clock_divider == 0 ){                                              // Check the clock divider to see if we should skip this ISR cycle
-        clock_divider = CV_CLOCK_DIVIDER;                                      // Reset the count-down timer
+  uint16_t input = adcCollect( adc_pipe );                                     // Grab the CV input that was converted since the last tick
+  if( TRIGGER ) adcStart( adc_pipe, MUX_CV_SR );                               // In trigger mode, go back to watching the gate
 
-        if( loop_length == 0 ){
+  DSPState    st;                                                              // Copy just the fields this kernel uses into locals (See STATE NOTES)
+  KernelState ks;
 
+  if( !LOOP ){
+    liveLoad( st );
 
-          // ----------------------- //
-          //   CV MODE
-          // ----------------------- //
 
-          // ------ INPUT ------ //
-          // Capture the current analog value from the CV input pin (not the audio input pin). Remember
-          // that the CV input pin does not have a DC-blocking capacitor, while the audio input does.
-          uint16_t val = analogRead( PIN_IN_CV );                              // Capture the initial value
-          input_buffer[input_index] = val;                                   // Capture value in the input array
+    // ----------------------- //
+    //   CV MODE
+    // ----------------------- //
 
-          // ------ TRANSFORMATION: Glide ------ //
-          rolling_avg = (uint32_t(rolling_avg) * glide + (uint32_t(val) * 16)) / (glide + 16); // Calculate the glide average for filtering
-          val = rolling_avg;                                                   // Set val to the filtered value
+    // ------ INPUT ------ //
+    // Capture the current analog value from the CV input pin (not the audio input pin). Remember
+    // that the CV input pin does not have a DC-blocking capacitor, while the audio input does.
+    uint16_t val = input;                                                      // Capture the initial value
 
-          // ------ TRANSFORMATION: Scale Crush ------ //
-          uint8_t note = ((uint32_t(val) * 120) >> 10 );                       // Quantize the note to a chromatic scale, assuming 1v/oct
-          note_scale = note % 12;                                              // Identify the note within the 12 note chromatic scale
-          note_oct   = note / 12;                                              // Figure out the octave of the note
+    // ------ TRANSFORMATION: Glide, Scale Crush & Transposition (See kernel.h) ------ //
+    cvStateLoad( ks );
+    uint8_t  step   = kernelCVScaleNote( ks, kernel_params, val );
+    cvStateStore( ks );
+    uint8_t  note   = kernelCVTranspose( kernel_params, step );
+    uint16_t output = NOTE_LEVEL.level[note];                                  // Ideal 0...1023 level of the note
+    KernelCVCell cell = kernelCVCell<TRIGGER>( step, cv_input[uint8_t(st.input_index - 1)] ); // The step as a loop records it (See CV LOOP NOTES)
+    cv_input[st.input_index] = cell;                                           // Capture the step in the input array
 
-          
-          for( uint8_t i = 0; i<12; i++ ){                                     // Generate a probability map for each of the 12 notes in the scale
-            prob_map[i] = ( SCALE_PROB[scale_index][i] + random(SCALE_PROB_RANGE) - (SCALE_PROB_RANGE>>1) ) > (1023 - scale_crush) ? 1 : 0; 
-          }                                                                    // Probability map will contain a 1 or 0 for each key in scale if it is valid or not
-          while( (note_scale>0) && (prob_map[note_scale] == 0) ) note_scale--; // Take the current note and constrain it to the probability mapped scale
+    // ------ OUTPUT ------ //
+    output_buffer[st.output_index] = output;                                   // Store the output value into the output buffer so it can be shown on the screen
+    cv_morph[st.output_index] = cell;                                          // Store the step into the morph buffer
+    dacWrite( note_dac[note] );                                                // Set the DAC output (calibrated, See DSP::calibrateOctaves)
 
-          // ------ TRANSFORMATION: Transposition ------ //
-          note = note_scale + note_oct * 12 + note_offset;                        // Calculate the new note and add the transposition
-          if( note > 120 ) note = 120;                                         // Constrain the note to be less than 120 notes (10v output 12 notes per octave)
+    // Increment the input and output pointers so they can be tracked in their respective buffers
+    st.input_index  = (st.input_index  + 1) & 0xFF;                            // Increment the input_index (rotate around 255)
+    st.output_index = (st.output_index + 1) & 0xFF;                            // Increment the output_index (rotate around 255)
+    liveStore( st );                                                           // Write the indices back once on the way out
+    return;
+  }
 
-          uint16_t output = (uint32_t(note) << 10) / 120;                      // Convert from a note number to an output voltage
 
-          // ------ OUTPUT ------ //
-          output_buffer[output_index] = output;                              // Store the output value into the output buffer so it can be shown on the screen
-          morph_buffer[output_index] = output;                               // Store the output value into the morph buffer
-          DAC0.DATA = output << 6;                                             // Set the DAC output
+  // ----------------------- //
+  //   CV LOOPING MODE
+  // ----------------------- //
 
-          // Increment the input and output pointers so they can be tracked in their respective buffers
-          input_index  = (input_index  + 1) & 0xFF;                        // Increment the input_index (rotate around 255)
-          output_index = (output_index + 1) & 0xFF;                        // Increment the output_index (rotate around 255)
+  // ------ INPUT ------ //
+  // Pick the step out of the recorded loop or the morph buffer. Glide & the scale crush are already in it (See CV LOOP NOTES)
+  loopLoad( st );
+  KernelCVCell cell = kernelCVLoopCell( cv_input, cv_morph, st.loop_pointer, morph_grains[st.grain] ); // Steps are notes, so no slew
 
-        } else {
+  // ------ TRANSFORMATION: Transposition (See kernel.h) ------ //
+  uint8_t  note   = kernelCVTranspose( kernel_params, cell & KERNEL_CV_NOTE );
+  uint16_t output = NOTE_LEVEL.level[note];                                    // Ideal 0...1023 level of the note
 
+  // ------ OUTPUT ------ //
+  output_buffer[st.loop_pointer >> scope_shift] = output;                      // Store the output value into the output buffer so it can be shown on the screen (decimated for long loops)
+  dacWrite( note_dac[note] );                                                  // Set the DAC output (calibrated, See DSP::calibrateOctaves)
 
-          // ----------------------- //
-          //   CV LOOPING MODE
-          // ----------------------- //
 
-          uint16_t val;                                                        // will contain the output value
+  // MORPH COUNTER NOTES:
+  // • Once the morph_counter reaches zero, the morph_buffer gets overwritten by the input_buffer for one cycle and the input_buffer gets written into
+  // • Only the steps that get recorded go through glide & the scale crush, so the rest of the cycles are just the table read above
+  // • The CV input gets converted either way, but since the ADC runs in the background it doesn't cost the ISR anything (and the timing stays the same).
+  // • The loop pointer ticks once with every ISR. Once the loop fully cycles, it ticks the morph_counter. 
+  // • When the morph_counter reaches zero, it resets based on morph_rate (See loopAdvance)
 
-          // ------ INPUT ------ //
-          // Capture the current analog value from the CV input pin (not the audio input pin). Remember
-          // that the CV input pin does not have a DC-blocking capacitor, while the audio input does.
-          if( morph_rate >= 8 ){
-            val = TWEEN256( input_buffer[loop_pointer], morph_buffer[loop_pointer], TWEEN_FN[(morph_counter >> (morph_rate - 8))] );
-          } else {
-            val = TWEEN256( input_buffer[loop_pointer], morph_buffer[loop_pointer], TWEEN_FN[(morph_counter << (8 - morph_rate))] );
-          }
+  if( st.morph_counter == 0 ){                                                 // See if the morph_counter has reached zero yet
+    uint16_t prev = st.loop_pointer ? st.loop_pointer - 1 : st.loop_length - 1; // The step before this one (for the tie)
+    cv_morph[st.loop_pointer] = cv_input[st.loop_pointer];                     // If it did, then start repopulating the morph_buffer with the current input_buffer
+    cvStateLoad( ks );                                                         // (Only the steps that get recorded need the glide & scale state)
+    cv_input[st.loop_pointer] = kernelCVCell<TRIGGER>( kernelCVScaleNote( ks, kernel_params, input ), cv_input[prev] ); // And simultaneously, start overwriting the input_buffer with new steps
+    cvStateStore( ks );
+  }
 
+  loopAdvance( st );
+  loopStore( st );                                                             // Write back the loop position once on the way out
+}
 
-          // ------ TRANSFORMATION: Glide ------ //
-          rolling_avg = (uint32_t(rolling_avg) * glide + (uint32_t(val) * 16)) / (glide + 16); // Calculate the glide average for filtering
-          val = rolling_avg;                                                   // Set val to the filtered value
 
+// ----------------------- //
+//   CALLIBRATION MODE
+// ----------------------- //
+uint16_t cal_output = 0xFFC0;                                   // DAC0.DATA value calKernel sends out. DSP::calibrateOctaves moves it around
 
-          // ------ TRANSFORMATION: Scale Crush ------ //
-          uint8_t note = ((uint32_t(val) * 120) >> 10 );                       // Quantize the note to a chromatic scale, assuming 1v/oct
-          note_scale = note % 12;                                              // Identify the note within the 12 note chromatic scale
-          note_oct   = note / 12;                                              // Figure out the octave of the note
+#define CAL_IN_PHASES 16                                        // Ticks per period of the square wave inputCalKernel sends out (power of 2)
+#define CAL_IN_SETTLE 0x8000                                    // Ticks to let the input's DC-blocking capacitor settle before measuring (a few seconds)
+#define CAL_IN_TICKS  (CAL_IN_PHASES * 64)                      // Ticks to measure (64 periods, so each bin still fits in 16-bits)
+#define CAL_IN_HIGH   0xA000                                    // High and low level of the square wave (+/- 1.25v around the middle)
+#define CAL_IN_LOW    0x6000                                    // which leaves plenty of room on either side of the audio input
 
+uint8_t  cal_phase = 0;                                         // Where inputCalKernel is in the square wave
+uint16_t cal_ticks = 0;                                         // Number of ticks measured so far
+uint16_t cal_bins[CAL_IN_PHASES];                               // Audio input readings added up for each tick of the square wave
 
-          for( uint8_t i = 0; i<12; i++ ){                                     // Generate a probability map for each of the 12 notes in the scale
-            prob_map[i] = ( SCALE_PROB[scale_index][i] + random(SCALE_PROB_RANGE) - (SCALE_PROB_RANGE>>1) ) > (1023 - scale_crush) ? 1 : 0; 
-          }                                                                    // Probability map will contain a 1 or 0 for each key in scale if it is valid or not
-          while( (note_scale>0) && (prob_map[note_scale] == 0) ) note_scale--; // Take the current note and constrain it to the probability mapped scale
+// Sends a square wave out and adds up what the audio input reads at each tick of it (See DSP::calibrateInput)
+void inputCalKernel(){
+  uint16_t val = adcNext( adc_pipe );                                          // Grab the audio input and start converting the next one
+  if( cal_ticks < CAL_IN_SETTLE + CAL_IN_TICKS ){                             // Count up through the settling time and then the measurement
+    if( cal_ticks >= CAL_IN_SETTLE ) cal_bins[cal_phase] += val;
+    cal_ticks++;
+  }
+  cal_phase = (cal_phase + 1) & (CAL_IN_PHASES - 1);
+  dacWrite( cal_phase < (CAL_IN_PHASES>>1) ? CAL_IN_HIGH : CAL_IN_LOW );
+}
 
+void calKernel(){
+  uint8_t count = --dsp_state.clock_divider;                                   // Subdivide the ISR by counting down the clock_divider
+  if( count == 1 ) adcStart( adc_pipe, MUX_IN_CV );                            // One tick out, start converting the CV input
+  if( count != 0 ) return;
+  dsp_state.clock_divider = CV_CLOCK_DIVIDER;                                  // Once the clock_divider hits zero, reset it back to CV_CLOCK_DIVIDER
+  uint16_t val = adcCollect( adc_pipe );                                       // Grab the CV input that was converted since the last tick
+  DSPState st;                                                                 // Copy just the buffer indices into locals (See STATE NOTES)
+  liveLoad( st );
+  input_buffer[st.input_index] = val;                                          // Just et the input_buffer to the current analog input value
+  output_buffer[st.output_index] = val;                                        // Just et the output_buffer to the current analog input value
+  kernel_state.rolling_avg = (kernel_state.rolling_avg + val) >> 1;            // Calculate the rolling_avg value of the input for the visualization
+
+  dacWrite( cal_output );                                                      // Set the DAC output (its highest value, unless the octaves are being measured)
+  st.input_index  = (st.input_index  + 1) & 0xFF;                              // Increment the input_index around the buffer (anding wiht 0xFF will flip it around at 256)
+  st.output_index = (st.output_index + 1) & 0xFF;                              // Increment the output_index around the buffer (anding wiht 0xFF will flip it around at 256)
+  liveStore( st );                                                             // Write the indices back once on the way out
+}
 
-          // ------ TRANSFORMATION: Transposition ------ //
-          note = note_scale + note_oct * 12 + note_offset;                     // Calculate the new note and add the transposition
-          if( note > 120 ) note = 120;                                         // Constrain the note to be less than 120 notes (10v output 12 notes per octave)
-          uint16_t output = (uint32_t(note) << 10) / 120;                      // Convert from a note number to an output voltage
+volatile SampleKernel sample_kernel = idleKernel;              // Kernel the ISR runs on every tick. Only ever changed by DSP::selectKernel()
+AudioRenderer render_audio = renderAudioSample<false>;          // Audio renderer used by DSP::process() for the block engine
 
- 
-          // ------ OUTPUT ------ //
-          output_buffer[output_index] = output;                                // Store the output value into the output buffer so it can be shown on the screen
-          DAC0.DATA = output << 6;                                             // Set the DAC output
-
-
-          // MORPH COUNTER NOTES:
-          // • Once the morph_counter reaches zero, the morph_buffer gets overwritten by the input_buffer for one cycle and the input_buffer gets written into
-          // • When the morph_coutner is still counting, we still exectue analogRead to maintain the same timing. Would be great if we didn't need this, but you get clicking...
-          // • The loop pointer ticks once with every ISR. Once the loop fully cycles, it ticks the morph_counter. 
-          // • When the morph_counter reaches zero, it resets based on morph_rate
-
-          if( morph_counter == 0 ){                                            // See if the morph_counter has reached zero yet
-            morph_buffer[loop_pointer] = input_buffer[loop_pointer];           // If it did, then start repopulating the morph_buffer with the current input_buffer
-            input_buffer[loop_pointer] = analogRead( PIN_IN_CV );              // And simultaneously, start overwriting the input_buffer with some new values
-          } else {                                                             // If not, then just...
-            analogRead( PIN_IN_CV );                                           // Read the current value of the CV input to keep the timing the same
-          }
-
-          if( ++loop_pointer >= loop_length ){                                 // Track progress through the loop, and once we hit the end of the loop
-            loop_pointer = 0;                                                  // Reset the loop pointer to zero and
-            if( morph_counter--==0 ) morph_counter = uint16_t(1)<<morph_rate;  // if morph_counter also hit zero, reset it to count down from 2^morph_rate 
-          }
-        }        
-      }
-      break;
 
+/*******************************************
+* MAIN ISR PROCESSING FUNCTION             *
+*******************************************/
 
-    case MODE_CAL:
+// PRIORITY NOTES:
+// • TCA0_OVF is the one level-1 (high priority) interrupt (See DSP::setup). It pre-empts everything else, so a burst of
+//   encoder ticks or an I2C transfer to the screen can no longer push a sample back.
+// • Everything else stays at level 0 and has to be short and safe to interrupt:
+//   - PORTC_PORT_vect (encoder) only touches the rot_* values, which the audio ISR never looks at.
+//   - The Wire/TWI and millis() interrupts belong to the core and don't share anything with the audio ISR either.
+//   - ADC0_RESRDY_vect shares adc_pipe with the audio ISR, so it turns the interrupts off for its few lines of bookkeeping.
+// • isr_latency_max keeps the worst time (in TCA0 ticks) between the timer overflow and the ISR getting going. Read it
+//   with DSP::getIsrLatency(). As long as it plus frame_period stays under TCA0.SINGLE.PER, no deadline was missed.
 
+uint16_t isr_latency_max = 0;                                   // Longest wait from the timer overflow to the start of the ISR (in TCA0 ticks)
 
-      // ----------------------- //
-      //   CALLIBRATION MODE
-      // ----------------------- //
+ISR(TCA0_OVF_vect) {
 
-      if( --clock_divider == 0 ){                                              // Subdivide the ISR by counting down the clock_divider
-        clock_divider = CV_CLOCK_DIVIDER;                                      // Once the clock_divider hits zero, reset it back to CV_CLOCK_DIVIDER
-        uint16_t val = analogRead( PIN_IN_CV );                                // Capture the initial value
-        input_buffer[input_index] = val;                                       // Just et the input_buffer to the current analog input value
-        output_buffer[output_index] = val;                                     // Just et the output_buffer to the current analog input value
-        rolling_avg = (rolling_avg + val) >> 1;                                // Calculate the rolling_avg value of the input for the visualization
+#if OUTPUT_FIRST
+  // --- OUTPUT --- //
+  DAC0.DATA = dac_next;                                                        // Send out the sample computed on the last tick before doing anything else
+  dacStamp();                                                                  // and note how long after the timer edge that happened
+#endif
 
-        DAC0.DATA = 0xFFC0;                                                    // Set the DAC output to its highest value
-        input_index  = (input_index  + 1) & 0xFF;                              // Increment the input_index around the buffer (anding wiht 0xFF will flip it around at 256)
-        output_index = (output_index + 1) & 0xFF;                              // Increment the output_index around the buffer (anding wiht 0xFF will flip it around at 256)
-      }
-      break;
+  // --- LATENCY --- //
+  uint16_t latency = TCA0.SINGLE.CNT;                                          // TCA0 restarted from zero at the overflow, so this is how long it took to get here
+  if( latency > isr_latency_max ) isr_latency_max = latency;                   // (with OUTPUT_FIRST that includes the DAC write, which is always the same few cycles)
+
+  // --- ISR SPEED LIMIT --- //
+  if( skip_ISR ){                                                              // If the ISR tries to run again while the current ISR is running, well, that's bad.
+    TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;                                  // If skip_ISR is true, then reset the ISR vector
+    return;                                                                    // and return out of the ISR function
   }
+  skip_ISR = true;                                                             // Turn skip_ISR on until we get through the enormous amonunt of stuff we need to do...
+
+  sample_kernel();                                                             // Run whichever kernel matches the current mode (See DSP::selectKernel)
+
+  adcScanNext( adc_pipe );                                                     // If the kernel didn't need the ADC this tick, scan one of the controls
 
-  frame_period = micros() - frame_start;                                       // Calculate the frame_period in microseconds
+  frame_period = TCA0.SINGLE.CNT;                                              // TCA0 started counting up from zero at the overflow, so this is how long the sample took (including getting into the ISR)
   
   skip_ISR = false;                                                            // We are now done with the ISR, so we can turn off skip_ISR
   TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;                                    // Don't forget to reset the interrupt flag!!
 }
 
+// The ADC scheduler files every conversion result from here (See adc.h)
+ISR(ADC0_RESRDY_vect) {
+  noInterrupts();                                                              // The audio ISR is level-1 and could pre-empt us halfway through updating adc_pipe
+  adcResultReady( adc_pipe );
+  interrupts();                                                                // AVR Dx doesn't clear the I flag on entry, so it has to be turned back on by hand
+}
 
 /*******************************************
 * DSP CLASS                                *
@@ -553,46 +741,151 @@ class DSP {
   private:
     uint8_t  *display_buffer        = NULL; // Contains a pointer to the display buffer
     Hardware* hw;
+    void selectKernel();                                                       // Points the ISR at the kernel that matches the current settings
+    void updateScale(){                                                        // Re-sorts the scale notes after the scale or crush changes (See kernelScale)
+      KernelScale sc;
+      kernelScale( sc, kernel_params.scale_index, kernel_params.scale_crush ); // Do the work out here
+      noInterrupts(); kernel_params.scale = sc; interrupts();                  // and just swap the result in so the ISR never sees half a scale
+    }
+    uint16_t glide_setting = 1000;                                             // Last Filter knob value, so the glide can be recalculated when the rate changes
+    void updateGlide(){                                                        // Recalculates the glide coefficient for the current knob and CV step rate
+      uint16_t k = kernelGlideCoef( glide_setting, kernelPhaseTicks( dsp_state.cv_phase_inc, ISR_TICK_PERIOD ) ); // Float math stays out here in loop()
+      noInterrupts(); kernel_params.glide = k; interrupts();
+    }
+    uint16_t calMeasure( uint16_t dac );                                       // Sends out a DAC value and measures it through the IN <- OUT loopback
+    void updateKeyboard();                                                     // Builds the keyboard string from the notes in the current scale
+    void layoutArena( uint8_t mode );                                          // Carves the arena up into the buffers the mode needs (See ARENA NOTES)
+    uint8_t reverb_delay_setting = 0x80;                                       // Last Reverb Delay menu value, so the taps can be re-spread when the layout changes
+    void updateReverbTaps(){                                                   // Re-spreads the comb taps for the current delay (See kernelReverbDelay)
+      KernelParams p = kernel_params;                                          // Do the divides out here
+      kernelReverbDelay( p, reverb_delay_setting );
+      noInterrupts();                                                          // and just swap the taps in so the ISR never reads half of them
+      kernel_params.reverb_delay = p.reverb_delay;
+      for( uint8_t k = 0; k < REVERB_TAPS; k++ ) kernel_params.reverb_taps[k] = p.reverb_taps[k];
+      interrupts();
+    }
+#if BITCRUSH_TABLE
+    KernelCrushBuild crush_build = {};                                         // Back bitcrush table that's partway through being rebuilt
+    bool buildBitCrush();                                                      // Rebuilds another chunk of the back table. Returns true once it's swapped in
+#endif
 
   public:
     DSP( Hardware* _hw ){ hw = _hw; };                                         // Constructor
     void setup();                                                              // Setup the hardware for the DAC
     void setMode( uint8_t mode );                                              // Set the mode of the DSP MODE_IDLE, MODE_AUD, MODE_CV, MODE_CAL
-    uint16_t getFramePeriod(){ return frame_period; }                          // Exposes the frame period externally to the class
+    uint16_t getFramePeriod(){                                                 // Exposes the frame period (in microseconds) externally to the class
+      noInterrupts(); uint16_t fp = frame_period; interrupts();                // Grab it in one piece since the ISR writes it on every tick
+      return fp / (M_CLOCK_FRQ / 1000000);                                     // and convert from TCA0 ticks to microseconds
+    }
+    uint16_t getDacJitter(){                                                   // Spread of DAC write times (in TCA0 ticks) since the last call
+      noInterrupts();
+      uint16_t spread = (dac_jitter_max >= dac_jitter_min) ? dac_jitter_max - dac_jitter_min : 0;
+      dac_jitter_min = 0xFFFF;                                                 // Start a fresh measurement window
+      dac_jitter_max = 0;
+      interrupts();
+      return spread;
+    }
+    uint16_t getIsrLatency(){                                                  // Worst overflow-to-ISR latency (in TCA0 ticks) since the last call
+      noInterrupts();
+      uint16_t latency = isr_latency_max;
+      isr_latency_max = 0;                                                     // Start a fresh measurement window
+      interrupts();
+      return latency;
+    }
+    uint16_t getBootTime(){ return boot_ms; }                                  // Milliseconds from reset until DSP::setup finished (0xFFFF before that)
+    uint16_t getScaleMask(){                                                   // Notes in the scale on the last CV step (bit 0 = C ... bit 11 = B)
+      noInterrupts(); uint16_t m = kernel_state.scale_mask; interrupts();
+      return m;
+    }
+    uint16_t getLoopLength(){ return dsp_state.loop_length; }                  // Only loop() ever writes loop_length, so no need to lock it out here
+    uint16_t getLoopPointer(){                                                 // Current position in the loop (the ISR moves this on every sample)
+      noInterrupts(); uint16_t lp = dsp_state.loop_pointer; interrupts();
+      return lp;
+    }
+    uint8_t getOutputIndex(){                                                  // Next spot the ISR will write in the output buffer
+      noInterrupts(); uint8_t oi = dsp_state.output_index; interrupts();       // noInterrupts() also keeps the compiler from caching it
+      return oi;
+    }
+    void process();                                                            // Finishes bitcrush rebuilds and renders any pending audio blocks (BLOCK_ENGINE)
+    uint16_t getUnderruns(){                                                   // Number of samples the ISR had to skip because dac_ring ran dry
+      noInterrupts(); uint16_t u = underruns; interrupts();                    // underruns is 16-bits, so grab it without the ISR changing it halfway through
+      return u;
+    }
 
     // --- External Hardware Control Functions ---
     void setSampleRateExp(uint16_t sr);                                        // Set the sample rate exponentially
     void setBitCrush(uint16_t bc){                                             // Set the bitcrush and scale crush values
-      scale_crush = bc; 
-      uint16_t bc_counter = bc>>1;                        
-      uint16_t val = 0;
-      for( uint16_t i = 0; i<1024; i++ ){
-        bitcrush_conversion[i] = min(val + (bc>>2), uint16_t(0x3FF));
-        if( bc_counter-- == 0 ){ bc_counter = bc>>1; val = i; }
-      }
+      kernel_params.scale_crush = bc; 
+#if BITCRUSH_TABLE
+      kernelBitCrushRequest( crush_build, bc );                                // Rebuild the back table with the input correction. process() finishes it
+                                                                               // off and swaps it in (See buildBitCrush & BITCRUSH TABLE NOTES in kernel.h)
+#else
+      KernelParams p = kernel_params;                                          // Work out the arithmetic crush settings out here
+      kernelBitCrushArith( p, bc, input_cal );
+      noInterrupts();                                                          // and swap them in together
+      kernel_params.crush_step  = p.crush_step;
+      kernel_params.crush_add   = p.crush_add;
+      kernel_params.crush_recip = p.crush_recip;
+      kernel_params.input_cal   = p.input_cal;
+      interrupts();
+#endif
+      updateScale();                                                           // The crush decides which notes make it into the scale
     }
     void setGlide(uint16_t gl){                                                // Set the value of the "filter" from 0...1024
-      glide = 255-(gl >> 2);                                                   // Glide goes from 0...255, but gets inverted
-      alpha = min( ((gl >> 2) * uint8_t(255) ) / ( uint8_t(64) + (gl >> 2) ), uint8_t(255)); // Sets the value of the filter
+      glide_setting = gl;
+      kernelAlpha( kernel_params, gl );                                        // Audio mode uses it as the filter cutoff
+      updateGlide();                                                           // and CV mode uses it as the glide time
     }
 
     // --- Audio Menu Setting Functions ---
     void setMorphRate( uint8_t _morph_rate ){                                  // Set the speed of the morph rate (only used in loop mode)
-      morph_rate = _morph_rate;                                                // Assign the value. But then ensure that the current morph_counter
-      if( morph_counter > (uint16_t(1) << morph_rate) ) morph_counter = uint16_t(1) << morph_rate; // Update the morph counter to be 2^morph_rate 
+      if( _morph_rate == dsp_state.morph_rate ) return;                        // This gets called on every loop, so only do the work when it changes
+      noInterrupts();                                                          // Keep the ISR out until the matching kernel is in place
+      dsp_state.morph_rate = _morph_rate;                                      // Assign the value. But then ensure that the current morph_counter
+      uint16_t morph_max = uint16_t(1) << _morph_rate;                         // never runs past 2^morph_rate
+      if( dsp_state.morph_counter > morph_max ) dsp_state.morph_counter = morph_max; // Update the morph counter to be 2^morph_rate 
+      kernelMorphGrains( morph_grains, dsp_state.morph_counter, _morph_rate ); // The grain windows moved, so don't wait for the end of the cycle
+      interrupts();
+    }
+    void setLoopLength( uint16_t _loop_length ){                               // Set value of loop_length     0...loop_capacity
+      if( _loop_length > loop_capacity ) _loop_length = loop_capacity;         // Never play past the end of the buffers in the current layout
+      if( _loop_length == dsp_state.loop_length ) return;                      // This gets called on every loop, so only do the work when it changes
+      uint16_t grain_length = _loop_length / MORPH_GRAINS;                     // Divide out here in loop() so the ISR never has to
+      if( grain_length == 0 ) grain_length = 1;
+      uint8_t shift = scopeShift( _loop_length );
+      noInterrupts();                                                          // Keep the ISR out until the matching kernel is in place
+      scope_shift            = shift;                                          // The loop still has to fit in output_buffer
+      dsp_state.loop_length  = _loop_length;
+      dsp_state.grain_length = grain_length;                                   // The grains line up with the new length from the next cycle on
+      selectKernel();                                                          // Might have switched between live and loop (turns interrupts back on)
     }
-    void setLoopLength(     uint16_t _loop_length ){    loop_length     = _loop_length; }          // Set value of loop_length     0...255
-    void setResonance(      uint8_t _resonance ){       resonance       = _resonance; }            // Set value of resonance       0...255
-    void setReverbFeedback( uint8_t _reverb_feedback ){ reverb_feedback = _reverb_feedback >> 1; } // Set value of reverb_feedback 0...255
-    void setReverbAmount(   uint8_t _reverb_wet_mix ){  reverb_wet_mix  = _reverb_wet_mix; }       // Set value of reverb_wet_mix  0...255
-    void setReverbDelay(    uint8_t _reverb_delay ){                                               // Set value of reverb_delay    0...255
-      reverb_delay = uint16_t(_reverb_delay) << 3;                             // Scale reverb delay to 0...2048 to match the buffer size
-      reverb_read_index = (reverb_write_index + REVERB_BUFFER_SIZE - reverb_delay) % REVERB_BUFFER_SIZE; // Set the reverb_read_index based on the current dealy
+    void setLoopPitch( uint8_t _loop_pitch ){                                  // Set the audio loop's transposition 0...2*LOOP_PITCH_RANGE semitones (LOOP_PITCH_RANGE is the recorded pitch)
+      if( _loop_pitch > LOOP_PITCH_RANGE * 2 ) _loop_pitch = LOOP_PITCH_RANGE * 2;
+      uint32_t step = LOOP_PITCH.step[_loop_pitch];
+      noInterrupts(); dsp_state.loop_step = step; interrupts();                // 32-bit, so don't let the ISR see half of it
+    }
+    void setResonance(      uint8_t _resonance ){       kernel_params.resonance       = _resonance; }            // Set value of resonance       0...255
+    void setReverbFeedback( uint8_t _reverb_feedback ){ kernel_params.reverb_feedback = _reverb_feedback >> 1; } // Set value of reverb_feedback 0...255
+    void setReverbAmount(   uint8_t _reverb_wet_mix ){  kernel_params.reverb_wet_mix  = _reverb_wet_mix; }       // Set value of reverb_wet_mix  0...255
+    void setReverbDelay(    uint8_t _reverb_delay ){                         // Set value of reverb_delay 0...255
+      if( _reverb_delay == reverb_delay_setting ) return;                      // This gets called on every loop, so only do the work when it changes
+      reverb_delay_setting = _reverb_delay;
+      if( kernel_params.reverb_size ) updateReverbTaps();                      // (only once the layout has a reverb)
     }
 
     // CV Menu Setting Functions
-    void setRoot(  uint8_t _note_offset ){ note_offset = _note_offset; }       // Set the root note for transposition. Note: Transposition occurs after quantization
-    void setScale( uint8_t _scale_index  ){ scale_index  = _scale_index;  }    // Set the current scale ID
+    void setRoot(  uint8_t _note_offset ){ kernel_params.note_offset = _note_offset; } // Set the root note for transposition. Note: Transposition occurs after quantization
+    void setScale( uint8_t _scale_index  ){                                    // Set the current scale ID
+      if( _scale_index == kernel_params.scale_index ) return;                  // This gets called on every loop, so only do the work when it changes
+      kernel_params.scale_index = _scale_index;
+      updateScale();
+    }
+    void setQuantMode( uint8_t _quant_mode ){ kernel_params.quant_mode = _quant_mode; } // Set which way notes snap to the scale (QUANT_NEAREST, QUANT_UP, QUANT_DOWN)
+
+    // Calibration Functions
+    void loadCalibration();                                                    // Builds the note -> DAC table from the octave points saved in EEPROM
+    bool calibrateOctaves();                                                   // Measures the output at every octave and saves the result to EEPROM
+    bool calibrateInput();                                                     // Measures the audio input's offset and gain and saves them to EEPROM
 
     // Visualization Functions
     void drawOscilloscope();                                                   // Draws oscilloscope in the top 32 rows of the screen
@@ -610,11 +903,8 @@ class DSP {
 *******************************************/
 
 void DSP::setup(){                                                             // Core setup function for the DSP class
-  // pre-calculate sample_rate_conversion array                                
-  for( uint16_t i=0; i<SAMPLE_RATE_CONVERSION_SIZE; i++ ){                     // With only 1024 possible values for sr, we can pre-calculate the period associated
-    sample_rate_conversion[i] = (M_CLOCK_FRQ/LOW_SAMP_FRQ) / (pow(2, float(i)*OCT_RANGE/1024)); // with a 1v/oct exponential sample rate input.
-    if( sample_rate_conversion[i] < 2000 ) sample_rate_conversion[i] = 2000;   // This caps the sample period at a minimum of 80 uS to ensure ISR doesn't trigger too fast
-  }                                                                            // 80 uS represents 12.5 kHz, which is the highest sample rate this module supports
+  kernelReset( kernel_state );                                                 // Center the filter history and line up the reverb heads
+  loadCalibration();                                                           // Fill in note_dac before the CV kernels can use it
 
   // Set up the DAC
   PORTD.PIN6CTRL &= ~PORT_ISC_gm;                                              // This sets up the interrupt service routine, but don't ask me how
@@ -626,17 +916,22 @@ void DSP::setup(){                                                             /
 
   // Set Up the Timer Interrupt
   takeOverTCA0();                                                              // Override the timer
-  TCA0.SINGLE.PER = 10000;                                                     // This is the sample period (20 MHz / this value)  0x0271
+  TCA0.SINGLE.PER = ISR_TICK_PERIOD;                                           // The ISR always ticks at the top sample rate (the Rate knob never touches this, See setSampleRateExp)
   TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;                                     // Enable overflow interrupt
-  TCA0.SINGLE.CTRLA = TCA_SINGLE_ENABLE_bm;                                    // Enable the timer with no prescaler  
+  CPUINT.LVL1VEC = TCA0_OVF_vect_num;                                          // Make the timer the high priority interrupt so nothing else can hold up a sample
+  TCA0.SINGLE.CTRLA = TCA_SINGLE_ENABLE_bm;                                    // Enable the timer with no prescaler (after LVL1VEC, so even the first tick is level-1)
 
   setSampleRateExp(1000);                                                      // Set an initial sample rate value (will be overwritten by the actual knob's value)
   setBitCrush(1000);                                                           // Set an initial bit crush value (will be overwritten by the actual knob's value)
+#if BITCRUSH_TABLE
+  while( !buildBitCrush() );                                                   // Build the first table in one go so the ISR never starts on an empty one
+#endif
   setGlide(1000);                                                              // Set an initial glide value (will be overwritten by the actual knob's value)
 
   setMode( MODE_IDLE );                                                        // Set the mode to idle so that the ISR just outputs the mid-point value
 
   display_buffer = hw->displayBuffer();                                        // Link up the local display_buffer value to the hw->displayBuffer();
+  boot_ms = millis();                                                          // Cold start time, tables and all (See OUTPUT NOTES)
 }
 
 
@@ -651,36 +946,301 @@ void DSP::setMode( uint8_t mode ){
     case MODE_CV:    digitalWrite( PIN_OFFSET, true  ); break;                 // CV Mode - output 0v to +10v
     case MODE_CAL:   digitalWrite( PIN_OFFSET, false ); break;                 // CV Mode - output 0v to +10v
   }
+  noInterrupts(); sample_kernel = idleKernel; interrupts();                    // Park the ISR in idle first so it doesn't touch the buffers or rings while they get reset
+  layoutArena( mode );                                                         // Lay the buffers out for the new mode
+#if BLOCK_ENGINE
+  if( mode == MODE_AUDIO ){                                                    // Starting audio mode with the block engine means resetting the rings
+    adc_head = 0;                                                              // Empty out the ADC ring
+    adc_tail = 0;
+    dac_tail = 0;                                                              // and fill the DAC ring with a bit of silence so loop() has
+    for( dac_head = 0; dac_head < RING_PRIME; dac_head++ ) dac_ring[dac_head] = 0x200; // some headroom before the ISR catches up to it
+    underruns = 0;                                                             // Start counting underruns from scratch
+  }
+#endif
   dsp_mode = mode;
+  selectKernel();                                                              // Point the ISR at the new mode's kernel
+}
+
+// Lays the arena out for a mode and clears it. Only call this with the ISR parked on idleKernel (See DSP::setMode)
+void DSP::layoutArena( uint8_t mode ){
+  const ArenaLayout &l = ARENA_LAYOUT[mode];
+  for( uint16_t i = 0; i < l.loop_size * 2; i++ ) arena[i] = l.rest;         // Wipe out whatever the last mode left behind
+
+  input_buffer  = arena;
+  morph_buffer  = arena + l.loop_size;
+  reverb_buffer = (KernelReverbCell *)(arena + l.loop_size * 2);
+  loop_capacity = l.loop_size;
+  if( l.cells == ARENA_AUDIO ){                                                // Audio mode packs more samples into the same words (See LOOP STORAGE NOTES)
+    loop_capacity = l.loop_size * 2 / sizeof(KernelLoopCell);
+    audio_input   = (KernelLoopCell *)arena;
+    audio_morph   = audio_input + loop_capacity;
+    for( uint16_t i = 0; i < loop_capacity * 2; i++ ) audio_input[i] = kernelLoopEncode( l.rest ); // Silence in the loop's format
+  }
+  if( l.cells == ARENA_CV ){                                                   // and so does CV mode (See CV LOOP NOTES)
+    loop_capacity = l.loop_size * 2 / sizeof(KernelCVCell);
+    cv_input      = (KernelCVCell *)arena;
+    cv_morph      = cv_input + loop_capacity;                                  // A rest of 0v is already note 0 with no tie, so the clear above covers it
+  }
+
+  kernel_params.reverb_buffer = reverb_buffer;
+  kernel_params.reverb_size   = l.reverb_size;
+  kernelReverbClear( kernel_params );                                          // The reverb gets silence (packed or not)
+  kernel_state.reverb_write_index = 0;                                         // Start the tape over
+  kernel_state.reverb_ap_index[0] = 0;
+  kernel_state.reverb_ap_index[1] = 0;
+  if( l.reverb_size ){
+    updateReverbTaps();                                                        // Spread the taps out over the new delay line
+    kernelReverbSnap( kernel_state, kernel_params );                           // and put the read heads right on them (there's nothing to bend yet)
+  }
+
+  if( dsp_state.loop_length > loop_capacity ) dsp_state.loop_length = loop_capacity;
+  scope_shift = scopeShift( dsp_state.loop_length );
+  dsp_state.loop_pointer = 0;
+  dsp_state.loop_frac    = 0;
+  dsp_state.grain        = 0;
+  dsp_state.grain_end    = dsp_state.grain_length;
+  kernelMorphGrains( morph_grains, dsp_state.morph_counter, dsp_state.morph_rate );
+  dsp_state.morph_weight = uint16_t(morph_grains[0]) << 7;                    // Start right on the first grain's weight
+  dsp_state.input_index  = 0;
+  dsp_state.output_index = 0;
+}
+
+// Picks the kernel for the current mode, loop state and trigger mode. Everything the
+// ISR used to check on every sample gets decided here instead, only when one of those settings changes.
+// The kernel pointer is 16-bits, so it gets swapped with the interrupts off. Interrupts are always on when it returns.
+void DSP::selectKernel(){
+  bool looping = dsp_state.loop_length > 0;
+
+  SampleKernel  kernel = idleKernel;
+  AudioRenderer render = renderAudioSample<false>;
+  switch( dsp_mode ){
+    case MODE_AUDIO:
+      if( !looping ){ kernel = audioKernel<false>; render = renderAudioSample<false>; }
+      else          { kernel = audioKernel<true >; render = renderAudioSample<true >; }
+      break;
+    case MODE_CV:
+      if( trigger_mode ){
+        if( !looping ) kernel = cvKernel<false, true>;
+        else           kernel = cvKernel<true,  true>;
+      } else {
+        if( !looping ) kernel = cvKernel<false, false>;
+        else           kernel = cvKernel<true,  false>;
+      }
+      break;
+    case MODE_CAL:
+      kernel = calKernel;
+      break;
+  }
+
+  noInterrupts();
+  sample_kernel = kernel;
+  render_audio  = render;
+  if(      dsp_mode == MODE_AUDIO )                  adcStart( adc_pipe, MUX_IN_AUD ); // Prime the ADC pipeline for the new kernel so its
+  else if( (dsp_mode == MODE_CV) && trigger_mode )  adcStart( adc_pipe, MUX_CV_SR );  // first conversion is already on the right channel
+  else if( dsp_mode != MODE_IDLE )                  adcStart( adc_pipe, MUX_IN_CV );
+  interrupts();
+}
+
+#if BITCRUSH_TABLE
+// Rebuilds the next BITCRUSH_CHUNK entries of the back bitcrush table, then swaps it to the front once it's all done.
+// If the knob moves again partway through, the new setting waits for this build to finish and then starts on the other table.
+bool DSP::buildBitCrush(){
+  uint16_t *back = (kernel_params.bitcrush == bitcrush_tables[0]) ? bitcrush_tables[1] : bitcrush_tables[0]; // Only loop() swaps it, so no lock needed to read it
+  if( !kernelBitCrushBuild( crush_build, back, input_cal, BITCRUSH_CHUNK ) ) return false;
+  noInterrupts(); kernel_params.bitcrush = back; interrupts();                 // The pointer is 16-bits, so swap it in one piece
+  kernelBitCrushDone( crush_build );                                           // and start on whatever setting came in meanwhile
+  return true;
+}
+#endif
+
+// Block engine producer. Drains whatever input the ISR has captured since the last call, renders it, and hands it
+// back to the ISR through dac_ring. Call this as often as possible from loop(), since the rings only buy a few ms.
+void DSP::process(){
+#if BITCRUSH_TABLE
+  if( crush_build.building ) buildBitCrush();                                  // Chip away at the bitcrush table rebuild
+#endif
+#if BLOCK_ENGINE
+  if( dsp_mode != MODE_AUDIO ) return;                                         // Only audio mode uses the rings
+  DSPState    st;                                                              // The ISR leaves the buffer positions alone in this mode, so loop() owns them here
+  KernelState ks;                                                              // and the filter & reverb state too, so it only gets loaded once for the whole batch
+  liveLoad( st );                                                              // (See STATE NOTES)
+  audioLoopLoad( st );
+  audioStateLoad( ks );
+  while( adc_tail != adc_head && uint8_t(dac_head + 1) != dac_tail ){          // As long as there is input waiting and space left for the output
+    uint16_t output = render_audio( st, ks, adc_ring[adc_tail] );              // render the next sample
+    adc_tail++;                                                                // free up its slot in the ADC ring
+    dac_ring[dac_head] = output;                                               // and queue the result up for the ISR
+    dac_head++;
+  }
+  noInterrupts();                                                              // Write back only the positions the renderer moved. The ISR is
+  liveStore( st );                                                             // still stepping the phase accumulator in the same struct, so copying
+  audioLoopStore( st );                                                        // the whole thing back would stomp on it.
+  interrupts();
+  audioStateStore( ks );                                                       // The ISR doesn't touch the filter & reverb state here, so it can go back with them on
+#endif
 }
 
 // Hardware Handler Functions
 void DSP::setSampleRateExp(uint16_t sr){                                       // Set the sample rate
   if( dsp_mode == MODE_CV ){                                                   // If we are in CV mode, then we need to check to see if we should switch to
-    trigger_mode = (hw->sampleRatePot < 16 );                                  // trigger mode (as indicated by used turning SR knob all the way down)
+    bool trigger = (hw->sampleRatePot < 16 );                                  // trigger mode (as indicated by used turning SR knob all the way down)
+    if( trigger != trigger_mode ){                                             // If that changed, then the CV kernel needs to change with it
+      trigger_mode = trigger;
+      selectKernel();
+    }
   }
   if( trigger_mode == true ){                                                  // If trigger_mode mode is true then we still set a sampel rate (of 5)
     sample_rate = 5;                                                           // because this is used to determine the zoom level in the visualization
-    TCA0.SINGLE.PER = sample_rate_conversion[800];                             // We also ensure the ISR rate is fast enough to catch even short triggers
-  } else {                                                                     // If we are not in trigger mode, then we can just set the sample_rate to
-    sample_rate = sr;                                                          // the value of sr and then...
-    uint8_t  srOct = sr / UNITS_PER_OCT;                                       // Calculate current octave of SR by dividing by units_per_oct
-    int8_t   octShift = OCT_RANGE - ISR_OCT_RANGE - srOct;                     // Figure out how many octaves this needs to shift to get into the correct range
-
-    if( octShift > 0 ){                                                        // If that number ends up being more than zero, we need to shift it.
-      ISR_period = 0b1 << octShift;                                            // Set the period of the ISR counter to be 2^octShift 
-      TCA0.SINGLE.PER = sample_rate_conversion[sr + octShift * UNITS_PER_OCT]; // Calc the period based on SR, but shift the pitch up by octShift octaves
-    } else {                                                                   // If we octShift is 0 or less, we don't have to change the octave at all
-      ISR_period = 0b1;                                                        // Set the ISR_period to 1 so the ISR runs every time
-      TCA0.SINGLE.PER = sample_rate_conversion[sr];                            // Set the timer count based on the original value of sr
-    }
+  } else {                                                                     // (the ISR always ticks at the top rate, so it catches even short triggers)
+    sample_rate = sr;                                                          // If we are not in trigger mode, then we can just set the sample_rate to the value of sr
+    uint32_t inc = kernelPhaseInc( PHASE_INC, kernelRatePitch( sr ) );         // and work out how much phase each tick adds (See SAMPLE RATE NOTES in kernel.h)
+    noInterrupts();                                                            // Both are 32-bit, so don't let the ISR see half of either
+    dsp_state.phase_inc    = inc;
+    dsp_state.cv_phase_inc = inc / CV_CLOCK_DIVIDER;
+    interrupts();
   }
+  updateGlide();                                                               // The CV step rate just changed, so keep the glide time the same
 }
 
 
 
 
 
+/*******************************************
+* Calibration Functions                    *
+*******************************************/
+
+// OCTAVE CALIBRATION NOTES:
+// • Callibration Mode already has the output patched into the CV input (IN <- OUT) to line up the trimpot. Once that's done,
+//   pressing Loop runs calibrateOctaves(), which uses the CV input as a ruler to straighten out the rest of the output range.
+// • The two ends stay where the trimpot put them (0v and the top of the DAC). Every octave in between gets nudged until its
+//   reading lands the right fraction of the way between the two ends, which takes out any bow in the DAC or the output stage.
+// • The result gets saved to EEPROM as KERNEL_OCTAVES+1 DAC values (See kernelNoteTable). CAL_EEPROM_TAG marks it as valid, so a
+//   module that has never been calibrated just gets a straight line.
+// • Before that, calibrateInput() measures the audio input with the same patch cable. The audio input is AC coupled, so it sends
+//   out a square wave and looks at the size of the jumps (gain) and where the readings settle around (offset). The correction
+//   gets folded into the bitcrush tables, so the ISR doesn't spend a single extra cycle on it.
+
+#define CAL_EEPROM_ADDR   0                                     // Where the octave calibration lives in EEPROM
+#define CAL_EEPROM_TAG    0xE7C1                                // Marks the EEPROM as holding a valid octave calibration
+#define CAL_SETTLE_STEPS  16                                    // CV steps to wait after moving the output before measuring it
+#define CAL_AVERAGE_STEPS 16                                    // CV steps added up for each measurement (16 x 10-bits still fits in 16-bits)
+#define CAL_ITERATIONS    4                                     // Number of times each octave gets measured and nudged
+#define CAL_MIN_SPAN      (100 * CAL_AVERAGE_STEPS)             // Smallest difference between the two ends that looks like IN <- OUT is patched
+
+struct OctaveCal {
+  uint16_t tag;                                                 // CAL_EEPROM_TAG once the module has been calibrated
+  uint16_t points[KERNEL_OCTAVES + 1];                          // DAC0.DATA value for the bottom of each octave (and the top of the last one)
+};
+
+struct InputCal {
+  uint16_t tag;                                                 // CAL_EEPROM_TAG once the input has been calibrated
+  KernelInputCal cal;                                           // Offset & gain correction for the audio input
+};
+
+#define CAL_INPUT_ADDR (CAL_EEPROM_ADDR + sizeof(OctaveCal))    // The input calibration lives right after the octave calibration
+
+// Builds the note -> DAC table and the input correction from the calibration saved in EEPROM
+void DSP::loadCalibration(){
+  OctaveCal cal;
+  EEPROM.get( CAL_EEPROM_ADDR, cal );
+  if( cal.tag != CAL_EEPROM_TAG ) kernelOctavePoints( cal.points );          // Never been calibrated, so just use a straight line
+  kernelNoteTable( note_dac, cal.points );
+
+  InputCal in;
+  EEPROM.get( CAL_INPUT_ADDR, in );
+  if( in.tag == CAL_EEPROM_TAG ) input_cal = in.cal;                          // Otherwise leave the input alone (setBitCrush folds this in)
+}
+
+// Sends a DAC value out through calKernel and measures it through the IN <- OUT loopback (returns the sum of CAL_AVERAGE_STEPS readings)
+uint16_t DSP::calMeasure( uint16_t dac ){
+  noInterrupts(); cal_output = dac; interrupts();
+  uint8_t start = getOutputIndex();                                            // calKernel moves output_index (and input_index) once per CV step
+  while( uint8_t(getOutputIndex() - start) < CAL_SETTLE_STEPS + CAL_AVERAGE_STEPS );
+  uint8_t  index = getOutputIndex();
+  uint16_t sum   = 0;
+  for( uint8_t i = 1; i <= CAL_AVERAGE_STEPS; i++ ) sum += input_buffer[ uint8_t(index - i) ]; // Add up the latest readings
+  return sum;
+}
+
+// Measures the output at every octave and saves the corrected octave points to EEPROM. Returns false if IN <- OUT isn't patched
+bool DSP::calibrateOctaves(){
+  if( dsp_mode != MODE_CAL ) return false;
+  hw->drawCStr("Measuring octaves... ", 21, 4);                               // This takes a little while, so let them know what's going on
+  hw->display();
+
+  OctaveCal cal;
+  cal.tag = CAL_EEPROM_TAG;
+  kernelOctavePoints( cal.points );                                            // Start from a straight line
+  uint16_t lo = calMeasure( cal.points[0] );                                   // Measure the two ends
+  uint16_t hi = calMeasure( cal.points[KERNEL_OCTAVES] );
+  bool ok = hi > lo + CAL_MIN_SPAN;
+
+  if( ok ){
+    int32_t dac_span = int32_t(cal.points[KERNEL_OCTAVES]) - cal.points[0];   // DAC units per reading unit is dac_span / (hi - lo)
+    for( uint8_t o = 1; o < KERNEL_OCTAVES; o++ ){
+      uint16_t target = lo + uint32_t(hi - lo) * o / KERNEL_OCTAVES;           // Where this octave should read if the output were perfectly straight
+      int32_t  dac    = cal.points[o];
+      for( uint8_t i = 0; i < CAL_ITERATIONS; i++ ){
+        int32_t error = int32_t(target) - int32_t(calMeasure( dac ));
+        dac += error * dac_span / int32_t(hi - lo);                           // Nudge the DAC value by however far off the reading was
+        dac  = constrain( dac, int32_t(0), int32_t(0xFFC0) );
+      }
+      cal.points[o] = dac;
+    }
+    EEPROM.put( CAL_EEPROM_ADDR, cal );
+    kernelNoteTable( note_dac, cal.points );                                   // calKernel doesn't use note_dac, so no need to lock out the ISR
+  }
+
+  noInterrupts(); cal_output = 0xFFC0; interrupts();                          // Back to the top of the DAC for lining up the trimpot
+  return ok;
+}
+
+// Measures the audio input's offset and gain error with a square wave through IN <- OUT and saves them to EEPROM. Returns false if
+// the jumps don't look anything like the square wave (i.e. IN <- OUT isn't patched)
+bool DSP::calibrateInput(){
+  if( dsp_mode != MODE_CAL ) return false;
+  hw->drawCStr("Measuring input...   ", 21, 4);                               // This takes a few seconds, so let them know what's going on
+  hw->display();
+
+  noInterrupts();                                                              // inputCalKernel runs on every tick (the top sample rate), so the input barely droops between ticks
+  for( uint8_t i = 0; i<CAL_IN_PHASES; i++ ) cal_bins[i] = 0;
+  cal_phase = 0;
+  cal_ticks = 0;
+  sample_kernel = inputCalKernel;                                              // Swap in the square wave kernel
+  adcStart( adc_pipe, MUX_IN_AUD );                                            // and point the ADC at the audio input
+  interrupts();
+
+  uint16_t ticks = 0;
+  while( ticks < CAL_IN_SETTLE + CAL_IN_TICKS ){ noInterrupts(); ticks = cal_ticks; interrupts(); }
+
+  selectKernel();                                                              // Back to calKernel
+
+  // The readings jump by the gain times the square wave at the edges. Compare two ticks apart, in case a conversion lands on an edge
+  int32_t total = 0, rise = 0, fall = 0;
+  for( uint8_t i = 0; i<CAL_IN_PHASES; i++ ){
+    total += cal_bins[i];
+    int32_t jump = int32_t(cal_bins[(i + 2) & (CAL_IN_PHASES - 1)]) - cal_bins[i];
+    if(  jump > rise ) rise =  jump;
+    if( -jump > fall ) fall = -jump;
+  }
+  int32_t measured = (rise + fall) >> 1;                                       // Size of the jumps (added up over every period)
+  int32_t ideal    = int32_t((CAL_IN_HIGH - CAL_IN_LOW) >> 6) * (CAL_IN_TICKS / CAL_IN_PHASES); // 10v out and 10v in both span 1024 counts
+  bool ok = (measured > (ideal >> 1)) && (measured < (ideal << 1));
+
+  if( ok ){
+    InputCal in;
+    in.tag        = CAL_EEPROM_TAG;
+    in.cal.offset = (total + (CAL_IN_TICKS>>1)) / CAL_IN_TICKS - 0x200;      // The square wave is centered, so the average is the resting point
+    in.cal.gain   = (ideal << 12) / measured;
+    EEPROM.put( CAL_INPUT_ADDR, in );
+    input_cal = in.cal;
+    setBitCrush( kernel_params.scale_crush );                                  // Rebuild the bitcrush table with the correction folded in
+  }
+  return ok;
+}
+
+
 /*******************************************
 * Visualization Functions                  *
 *******************************************/
@@ -692,25 +1252,26 @@ void DSP::drawOscilloscope(){
   uint32_t last_bit_val = 0;                                                   // Stores prior value of new_bit_val for comparison
   uint8_t  highlight = 0x00;                                                   // Stores a highlight mask to use for showing a the selected columns
   uint8_t  pixels_per_pos = 0;                                                 // The number of pixels to consume per element in buffer (divided by 2)
-  uint8_t  buffer_pos = 0;                                                     // Current position in the buffer
+  uint16_t buffer_pos = 0;                                                     // Current position in the buffer
   uint8_t  buffer_val = 0;                                                     // Tracks the value of the buffer at buffer_pos
-  uint8_t  lp = loop_pointer;                                                  // Capture the current position in the loop cuz... its gonna change in the ISR
+  uint16_t loop_length  = getLoopLength();                                     // Local copies of the DSP state used for drawing
+  uint16_t lp = getLoopPointer() >> scope_shift;                               // Capture the current position in the loop cuz... its gonna change in the ISR (in output_buffer entries)
+  uint16_t loop_span    = (loop_length + (1 << scope_shift) - 1) >> scope_shift; // Entries of output_buffer the loop covers (at most BUFFER_SIZE)
+  uint8_t  output_index = getOutputIndex();
   
   if( loop_length > 0 ){                                                       // See if we are in loop mode
-    if(      loop_length & 0b10000000 ){ pixels_per_pos =  1; }                // based on the highest bit in loop_length, determine the zoom depth for
-    else if( loop_length & 0b01000000 ){ pixels_per_pos =  2; }                // rendering the horizontal scale. pixels_per_pos determines how many
-    else if( loop_length & 0b00100000 ){ pixels_per_pos =  4; }                // horizontal pixels to render for each element in the loop. In this way
-    else if( loop_length & 0b00010000 ){ pixels_per_pos =  8; }                // a short loop will fill the screen and as you increase the loop length
-    else if( loop_length & 0b00001000 ){ pixels_per_pos = 16; }                // the visualization will zoom out to accommodate more values in the loop.
-    else if( loop_length & 0b00000100 ){ pixels_per_pos = 32; }
-    else if( loop_length & 0b00000010 ){ pixels_per_pos = 32; }
-    else if( loop_length & 0b00000001 ){ pixels_per_pos = 32; }
+    if(      loop_span >= 0x80 ){ pixels_per_pos =  1; }                       // based on the highest bit in loop_span, determine the zoom depth for
+    else if( loop_span >= 0x40 ){ pixels_per_pos =  2; }                       // rendering the horizontal scale. pixels_per_pos determines how many
+    else if( loop_span >= 0x20 ){ pixels_per_pos =  4; }                       // horizontal pixels to render for each element in the loop. In this way
+    else if( loop_span >= 0x10 ){ pixels_per_pos =  8; }                       // a short loop will fill the screen and as you increase the loop length
+    else if( loop_span >= 0x08 ){ pixels_per_pos = 16; }                       // the visualization will zoom out to accommodate more values in the loop.
+    else                        { pixels_per_pos = 32; }                       // Loops past BUFFER_SIZE come in decimated (See scopeShift)
   } else {                                                                     // If we are in normal mode, then we use the octave range to determine the zoom
     pixels_per_pos = OCT_RANGE - (sample_rate / UNITS_PER_OCT);                // As sample rate goes up, pixels per position goes down
     pixels_per_pos = pixels_per_pos + (pixels_per_pos >> 1) + 1;               // Adds ~50% 
-    buffer_pos = 255 + output_index - (255 / pixels_per_pos) - 1;            // Set the buffer position to the end of the cicular buffer
+    buffer_pos = uint8_t(255 + output_index - (255 / pixels_per_pos) - 1);   // Set the buffer position to the end of the cicular buffer
   }
-  buffer_val   = ( output_buffer[buffer_pos] ) >> 5;                           // Grab the current 10-bit buffer val and right shift 5 bits so it goes 0...31
+  buffer_val   = ( output_buffer[uint8_t(buffer_pos)] ) >> 5;                           // Grab the current 10-bit buffer val and right shift 5 bits so it goes 0...31
   last_bit_val = ( 0x80000000 >> buffer_val  ) - 1;                            // Set up last_bit_val by putting a 1 in the correct column and then subtract 1
                                                                                // this flips all of the bits under that value from 0 into a 1
 
@@ -719,12 +1280,12 @@ void DSP::drawOscilloscope(){
     if( (i % pixels_per_pos) == 0 ) buffer_pos++;                              // Buffer position updates on every cycle
     if( i & 0b1 ){                                                             // Screen position updates every other cycle
       screen_col = i >> 1;                                                     // The screen position is going to be the index divided by two
-      buffer_val = (output_buffer[buffer_pos] )>>5;                            // Grab the current value of the buffer
+      buffer_val = (output_buffer[uint8_t(buffer_pos)] )>>5;                            // Grab the current value of the buffer
 
       if( pixels_per_pos == 1 ){
-        highlight = (buffer_pos < loop_length ) && (uint8_t(buffer_pos>>1) != (lp>>1)) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
+        highlight = (buffer_pos < loop_span ) && ((buffer_pos>>1) != (lp>>1)) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
       } else {
-        highlight = (buffer_pos < loop_length ) && (uint8_t(buffer_pos) != lp) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
+        highlight = (buffer_pos < loop_span ) && (buffer_pos != lp) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
       }
       
       new_bit_val = (0x80000000 >> buffer_val) - 1;                            // Fill in 1's between the old value and the new one (to vertically connect points)
@@ -741,24 +1302,30 @@ void DSP::drawOscilloscope(){
     }
   }
 
-  //                  CHAR    WHITE KEY STATE       BLACK KEY STATE            Updates the keyboard visualization character array
-  hw->keyboard[0x0] = 0xF0 + (prob_map[0x0] << 1) + prob_map[0x1]; // C, C#    The keyboard visualization "string" is used to represent a keyboard using a series
-  hw->keyboard[0x1] = 0xF4 + (prob_map[0x0] << 1) + prob_map[0x1]; // C, C#    of 5x7 pixel characters. Each character represents half of a white-key. There are
-  hw->keyboard[0x2] = 0xF8 + (prob_map[0x2] << 1) + prob_map[0x1]; // D, C#    4 different combinations, the left half of an all-white key (like C), the right half
-  hw->keyboard[0x3] = 0xF4 + (prob_map[0x2] << 1) + prob_map[0x3]; // D, D#    of a key that includes the left-half of a black key (like between C and C#), the left
-  hw->keyboard[0x4] = 0xF8 + (prob_map[0x4] << 1) + prob_map[0x3]; // E, D#    half of a key that also includes a black key (like between C# and D) and the right half
-  hw->keyboard[0x5] = 0xFC + (prob_map[0x4] << 1) + prob_map[0x3]; // E, D#    of an all-white key (like E). In addition, there are four versions of these keys as well.
-  hw->keyboard[0x6] = 0xF0 + (prob_map[0x5] << 1) + prob_map[0x6]; // F, F#    (0) both the white and black key of the character are off
-  hw->keyboard[0x7] = 0xF4 + (prob_map[0x5] << 1) + prob_map[0x6]; // F, F#    (1) the white key is off, but the black key is on
-  hw->keyboard[0x8] = 0xF8 + (prob_map[0x7] << 1) + prob_map[0x6]; // G, F#    (2) the white key is on, but the black key is off
-  hw->keyboard[0x9] = 0xF4 + (prob_map[0x7] << 1) + prob_map[0x8]; // G, G#    (3) both the white and black keys are on.
-  hw->keyboard[0xA] = 0xF8 + (prob_map[0x9] << 1) + prob_map[0x8]; // A, G#    In this way, the approprite character can be found by taking the base character value and
-  hw->keyboard[0xB] = 0xF4 + (prob_map[0x9] << 1) + prob_map[0xA]; // A, A#    adding to it the binary value of the state of each key.
-  hw->keyboard[0xC] = 0xF8 + (prob_map[0xB] << 1) + prob_map[0xA]; // B, A#    prob_map gets updated over and over in the ISR, but the keyboard map only needs to be drawn
-  hw->keyboard[0xD] = 0xFC + (prob_map[0xB] << 1) + prob_map[0xA]; // B, A#    once per visualization cycle... that's why it's updated here instead.
+  updateKeyboard();                                                            // Refresh the keyboard string from the current scale
   // In half-screen mode, the keyboard strong will be drawn by the menu system if it is the currently selected menu option
 }
 
+// Builds the keyboard string for the menu and the full screen oscilloscope out of the current scale_mask
+void DSP::updateKeyboard(){
+  uint16_t keys = getScaleMask();                                              // One bit per note, C in bit 0
+  //                  CHAR    WHITE KEY STATE            BLACK KEY STATE                     Updates the keyboard visualization character array
+  hw->keyboard[0x0] = 0xF0 + (bitRead(keys, 0x0) << 1) + bitRead(keys, 0x1);                 // C, C#    The keyboard visualization "string" is used to represent a keyboard using a series
+  hw->keyboard[0x1] = 0xF4 + (bitRead(keys, 0x0) << 1) + bitRead(keys, 0x1);                 // C, C#    of 5x7 pixel characters. Each character represents half of a white-key. There are
+  hw->keyboard[0x2] = 0xF8 + (bitRead(keys, 0x2) << 1) + bitRead(keys, 0x1);                 // D, C#    4 different combinations, the left half of an all-white key (like C), the right half
+  hw->keyboard[0x3] = 0xF4 + (bitRead(keys, 0x2) << 1) + bitRead(keys, 0x3);                 // D, D#    of a key that includes the left-half of a black key (like between C and C#), the left
+  hw->keyboard[0x4] = 0xF8 + (bitRead(keys, 0x4) << 1) + bitRead(keys, 0x3);                 // E, D#    half of a key that also includes a black key (like between C# and D) and the right half
+  hw->keyboard[0x5] = 0xFC + (bitRead(keys, 0x4) << 1) + bitRead(keys, 0x3);                 // E, D#    of an all-white key (like E). In addition, there are four versions of these keys as well.
+  hw->keyboard[0x6] = 0xF0 + (bitRead(keys, 0x5) << 1) + bitRead(keys, 0x6);                 // F, F#    (0) both the white and black key of the character are off
+  hw->keyboard[0x7] = 0xF4 + (bitRead(keys, 0x5) << 1) + bitRead(keys, 0x6);                 // F, F#    (1) the white key is off, but the black key is on
+  hw->keyboard[0x8] = 0xF8 + (bitRead(keys, 0x7) << 1) + bitRead(keys, 0x6);                 // G, F#    (2) the white key is on, but the black key is off
+  hw->keyboard[0x9] = 0xF4 + (bitRead(keys, 0x7) << 1) + bitRead(keys, 0x8);                 // G, G#    (3) both the white and black keys are on.
+  hw->keyboard[0xA] = 0xF8 + (bitRead(keys, 0x9) << 1) + bitRead(keys, 0x8);                 // A, G#    In this way, the approprite character can be found by taking the base character value and
+  hw->keyboard[0xB] = 0xF4 + (bitRead(keys, 0x9) << 1) + bitRead(keys, 0xA);                 // A, A#    adding to it the binary value of the state of each key.
+  hw->keyboard[0xC] = 0xF8 + (bitRead(keys, 0xB) << 1) + bitRead(keys, 0xA);                 // B, A#    scale_mask gets updated over and over in the ISR, but the keyboard map only needs to be drawn
+  hw->keyboard[0xD] = 0xFC + (bitRead(keys, 0xB) << 1) + bitRead(keys, 0xA);                 // B, A#    once per visualization cycle... that's why it's updated here instead.
+}
+
 // Draw a full screen version of the oscilloscope
 void DSP::drawOscilloscopeFS(){
   uint32_t bit_img_col_H  = 0;                                                 // Contains a 32-pixel column (1 bit per pixel) of the image
@@ -768,28 +1335,29 @@ void DSP::drawOscilloscopeFS(){
   uint32_t last_bit_val_H = 0;                                                 // Stores prior value of new_bit_val for comparison
   uint32_t last_bit_val_L = 0;                                                 // Stores prior value of new_bit_val for comparison
 
-  uint8_t  lp = loop_pointer;                                                  // Capture the current position in the loop cuz... its gonna change in the ISR
+  uint16_t loop_length  = getLoopLength();                                     // Local copies of the DSP state used for drawing
+  uint16_t lp = getLoopPointer() >> scope_shift;                               // Capture the current position in the loop cuz... its gonna change in the ISR (in output_buffer entries)
+  uint16_t loop_span    = (loop_length + (1 << scope_shift) - 1) >> scope_shift; // Entries of output_buffer the loop covers (at most BUFFER_SIZE)
+  uint8_t  output_index = getOutputIndex();
 
   uint8_t  highlight = 0x00;                                                   // Stores a highlight mask to use for showing a the selected columns
   uint8_t  pixels_per_pos = 0;                                                 // The number of pixels to consume per element in buffer (divided by 2)
-  uint8_t  buffer_pos = 0;                                                     // Current position in the buffer
+  uint16_t buffer_pos = 0;                                                     // Current position in the buffer
   uint8_t  buffer_val = 0;                                                     // Tracks the value of the buffer at buffer_pos
   
   if( loop_length > 0 ){                                                       // See if we are in loop mode
-    if(      loop_length & 0b10000000 ){ pixels_per_pos =  1; }                // based on the highest bit in loop_length, determine the zoom depth for
-    else if( loop_length & 0b01000000 ){ pixels_per_pos =  2; }                // rendering the horizontal scale. pixels_per_pos determines how many
-    else if( loop_length & 0b00100000 ){ pixels_per_pos =  4; }                // horizontal pixels to render for each element in the loop. In this way
-    else if( loop_length & 0b00010000 ){ pixels_per_pos =  8; }                // a short loop will fill the screen and as you increase the loop length
-    else if( loop_length & 0b00001000 ){ pixels_per_pos = 16; }                // the visualization will zoom out to accommodate more values in the loop.
-    else if( loop_length & 0b00000100 ){ pixels_per_pos = 32; }
-    else if( loop_length & 0b00000010 ){ pixels_per_pos = 32; }
-    else if( loop_length & 0b00000001 ){ pixels_per_pos = 32; }
+    if(      loop_span >= 0x80 ){ pixels_per_pos =  1; }                       // based on the highest bit in loop_span, determine the zoom depth for
+    else if( loop_span >= 0x40 ){ pixels_per_pos =  2; }                       // rendering the horizontal scale. pixels_per_pos determines how many
+    else if( loop_span >= 0x20 ){ pixels_per_pos =  4; }                       // horizontal pixels to render for each element in the loop. In this way
+    else if( loop_span >= 0x10 ){ pixels_per_pos =  8; }                       // a short loop will fill the screen and as you increase the loop length
+    else if( loop_span >= 0x08 ){ pixels_per_pos = 16; }                       // the visualization will zoom out to accommodate more values in the loop.
+    else                        { pixels_per_pos = 32; }                       // Loops past BUFFER_SIZE come in decimated (See scopeShift)
   } else {
     pixels_per_pos = OCT_RANGE - (sample_rate / UNITS_PER_OCT);                // As sample rate goes up, pixels per position goes down
     pixels_per_pos = pixels_per_pos + (pixels_per_pos >> 1) + 1;               // Adds ~50% 
-    buffer_pos = 255 + output_index - (255/pixels_per_pos) - 1;              // Set the buffer position to the end of the cicular buffer
+    buffer_pos = uint8_t(255 + output_index - (255/pixels_per_pos) - 1);     // Set the buffer position to the end of the cicular buffer
   }
-  buffer_val   = ( output_buffer[buffer_pos] ) >> 4;                           // Grab the current 10-bit buffer val and right shift 5 bits so it goes 0...31
+  buffer_val   = ( output_buffer[uint8_t(buffer_pos)] ) >> 4;                           // Grab the current 10-bit buffer val and right shift 5 bits so it goes 0...31
 
   last_bit_val_H = (buffer_val > 31) ? (0x80000000 >> (buffer_val & 0x1F))-1 : 0-1;   // Set up last_bit_val by putting a 1 in the correct column and then subtract 1
   last_bit_val_L = (buffer_val > 31) ? 0x00000000 : (0x80000000 >> buffer_val) - 1;   // this flips all of the bits under that value from 0 into a 1
@@ -799,12 +1367,12 @@ void DSP::drawOscilloscopeFS(){
     if( (i % pixels_per_pos) == 0 ) buffer_pos++;                              // Buffer position updates on every cycle
     if( i & 0b1 ){                                                             // Screen position updates every other cycle
       screen_col = i >> 1;                                                     // The screen position is going to be the index divided by two
-      buffer_val = (output_buffer[buffer_pos] )>>4;                            // Grab the current value of the buffer
+      buffer_val = (output_buffer[uint8_t(buffer_pos)] )>>4;                            // Grab the current value of the buffer
 
       if( pixels_per_pos == 1 ){
-        highlight = (buffer_pos < loop_length ) && (uint8_t(buffer_pos>>1) != (lp>>1)) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
+        highlight = (buffer_pos < loop_span ) && ((buffer_pos>>1) != (lp>>1)) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
       } else {
-        highlight = (buffer_pos < loop_length ) && (uint8_t(buffer_pos) != lp) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
+        highlight = (buffer_pos < loop_span ) && (buffer_pos != lp) ? 0xFF : 0x00; // Highlight value if the buffer position is within the loop length
       }
       
       new_bit_val_H = (buffer_val > 31) ? (0x80000000 >> (buffer_val & 0x1F)) - 1 : 0-1;       // Calculate the pixels to draw in the top half of the screen
@@ -834,23 +1402,17 @@ void DSP::drawOscilloscopeFS(){
     }
   }
 
-  //                  CHAR    WHITE KEY STATE       BLACK KEY STATE            Updates the keyboard visualization character array
-  hw->keyboard[0x0] = 0xF0 + (prob_map[0x0] << 1) + prob_map[0x1]; // C, C#    The keyboard visualization "string" is used to represent a keyboard using a series
-  hw->keyboard[0x1] = 0xF4 + (prob_map[0x0] << 1) + prob_map[0x1]; // C, C#    of 5x7 pixel characters. Each character represents half of a white-key. There are
-  hw->keyboard[0x2] = 0xF8 + (prob_map[0x2] << 1) + prob_map[0x1]; // D, C#    4 different combinations, the left half of an all-white key (like C), the right half
-  hw->keyboard[0x3] = 0xF4 + (prob_map[0x2] << 1) + prob_map[0x3]; // D, D#    of a key that includes the left-half of a black key (like between C and C#), the left
-  hw->keyboard[0x4] = 0xF8 + (prob_map[0x4] << 1) + prob_map[0x3]; // E, D#    half of a key that also includes a black key (like between C# and D) and the right half
-  hw->keyboard[0x5] = 0xFC + (prob_map[0x4] << 1) + prob_map[0x3]; // E, D#    of an all-white key (like E). In addition, there are four versions of these keys as well.
-  hw->keyboard[0x6] = 0xF0 + (prob_map[0x5] << 1) + prob_map[0x6]; // F, F#    (0) both the white and black key of the character are off
-  hw->keyboard[0x7] = 0xF4 + (prob_map[0x5] << 1) + prob_map[0x6]; // F, F#    (1) the white key is off, but the black key is on
-  hw->keyboard[0x8] = 0xF8 + (prob_map[0x7] << 1) + prob_map[0x6]; // G, F#    (2) the white key is on, but the black key is off
-  hw->keyboard[0x9] = 0xF4 + (prob_map[0x7] << 1) + prob_map[0x8]; // G, G#    (3) both the white and black keys are on.
-  hw->keyboard[0xA] = 0xF8 + (prob_map[0x9] << 1) + prob_map[0x8]; // A, G#    In this way, the approprite character can be found by taking the base character value and
-  hw->keyboard[0xB] = 0xF4 + (prob_map[0x9] << 1) + prob_map[0xA]; // A, A#    adding to it the binary value of the state of each key.
-  hw->keyboard[0xC] = 0xF8 + (prob_map[0xB] << 1) + prob_map[0xA]; // B, A#    prob_map gets updated over and over in the ISR, but the keyboard map only needs to be drawn
-  hw->keyboard[0xD] = 0xFC + (prob_map[0xB] << 1) + prob_map[0xA]; // B, A#    once per visualization cycle... that's why it's updated here instead.
-
-  //hw->drawNum(frame_period, 0);
+  updateKeyboard();                                                            // Refresh the keyboard string from the current scale
+
+#if TIMING_PROBES
+  hw->drawNum(getFramePeriod(), 0);                                            // ISR time in uS
+  hw->drawNum(getDacJitter(), 1);                                              // Spread of the DAC write times in TCA0 ticks (See OUTPUT NOTES)
+  hw->drawNum(getIsrLatency(), 2);                                             // Worst timer-to-ISR latency in TCA0 ticks (See PRIORITY NOTES)
+  hw->drawNum(getBootTime(), 3);                                               // Reset to the end of DSP::setup in mS (See OUTPUT NOTES)
+#endif
+#if BLOCK_ENGINE
+  if( dsp_mode == MODE_AUDIO ) hw->drawNum(getUnderruns(), 0);                // Show the underrun count so you can see if loop() is keeping up
+#endif
   if( dsp_mode == MODE_CV ) hw->drawCStr(hw->keyboard, 14, 0, 3);     //          In full screen mode, draw the keyboard string onto the top of the screen
 
 }
@@ -861,11 +1423,12 @@ void DSP::drawCallibration(){
   uint32_t bit_img_col  = 0;                                                   // Contains a 32-pixel column (1 bit per pixel) of the image
   uint32_t new_bit_val  = 0;                                                   // Puts 1's in all of the bits between the last value and the current value
   uint32_t last_bit_val = 0;                                                   // Stores prior value of new_bit_val for comparison
+  uint8_t  output_index = getOutputIndex();                                    // Local copy of the output position, since the ISR keeps moving it
   uint8_t  buffer_pos = (255 + output_index - 254) & 0xFF;                   // Current position in the buffer
 
   last_bit_val = (uint32_t(0b10) << ((output_buffer[buffer_pos] )>>5)) - 1;    // Set up last_bit_val by putting a 1 in the correct column and then subtract 1
 
-  int16_t currentVal = rolling_avg - (0x200-0x40) - CALLIBRATION_OFFSET;       // Grab the latest weighted average input value
+  int16_t currentVal = kernel_state.rolling_avg - (0x200-0x40) - CALLIBRATION_OFFSET;       // Grab the latest weighted average input value
 
   // Plot out the oscilloscope visualization on the top of the screen
   uint8_t screen_col = 0;                                                      // Track the current column on the screen that we are rendering
@@ -922,7 +1485,7 @@ void DSP::drawCallibration(){
     if( currentVal < 30 ){                                                     // Provide additional instruction to the user to keep turning Counter Clockwise
       hw->drawCStr("A bit more CCW      ", 20, 4);
     } else if( currentVal < 34 ){                                              // When the indicator is in range, tell them to stop turning the dial
-      hw->drawCStr("That's Perfect!     ", 20, 4);
+      hw->drawCStr("Perfect! Press Loop ", 20, 4);                            // Now the octaves in between can be calibrated (See calibrateOctaves)
     } else {
       hw->drawCStr("A bit more Clockwise", 20, 4);                             // If they go to far, tell them to turn it back a little
     }
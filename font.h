@@ -70,7 +70,7 @@ NOTE: I have added a set of keyboard visualization characters in the last 16 ele
 #define CHAR_HEIGHT 7
 
 // standard ascii 5x7 font with 6th column for spacing and to accommodate block characters
-static unsigned char font5x7[] = {
+static const unsigned char font5x7[] PROGMEM_MAPPED = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x00 (nul)
 	0x3E, 0x5B, 0x4F, 0x5B, 0x3E, 0x00,  // 0x01 (soh)
 	0x3E, 0x6B, 0x4F, 0x6B, 0x3E, 0x00,  // 0x02 (stx)
@@ -42,6 +42,7 @@ firmware code.
 #define SSD1306_NO_SPLASH
 #include <Adafruit_SSD1306.h>
 #include "font.h"
+#include "adc.h"
 
 /*******************************************
 * Screen Defaults & Setup                  *
@@ -53,6 +54,9 @@ firmware code.
 #define SCREEN_HEIGHT  64             // OLED display height, in pixels
 #define OLED_RESET     -1             // Reset pin # (or -1 if sharing Arduino reset pin)
 #define SCREEN_ADDRESS 0x3D           // See datasheet for Address; 0x3D for 128x64, 0x3C for 128x32
+#define SCREEN_I2C     0x3C           // The address the module's display actually answers on (See Hardware::setup)
+#define SCREEN_BYTES   (SCREEN_WIDTH * SCREEN_HEIGHT / 8)  // Size of the frame buffer
+#define SCREEN_CHUNK   31             // Pixel bytes per Wire transmission (plus the 0x40 data prefix, it fills the 32 byte Wire buffer)
 
 #define SCREEN_VISIBLE_COLS 21        // The number of visible columns on the screen (not the entire buffer)
 #define SCREEN_BUFFER_COLS  42        // The number of columns in the buffer
@@ -71,6 +75,17 @@ firmware code.
 #define PIN_POT_GLIDE PIN_PF0         // Glide Potentiometer
 #define PIN_CV_GLIDE  PIN_PF1         // Glide CV Input
 
+// ADC0 CHANNELS (for the pins above):
+#define MUX_POT_SR    ADC_MUXPOS_AIN2_gc  // PD2
+#define MUX_CV_SR     ADC_MUXPOS_AIN3_gc  // PD3 (the DSP also watches this one directly in trigger mode)
+#define MUX_POT_BC    ADC_MUXPOS_AIN4_gc  // PD4
+#define MUX_CV_BC     ADC_MUXPOS_AIN5_gc  // PD5
+#define MUX_POT_GLIDE ADC_MUXPOS_AIN16_gc // PF0
+#define MUX_CV_GLIDE  ADC_MUXPOS_AIN17_gc // PF1
+
+// The ADC scheduler converts these round-robin in the gaps between samples (See adc.h). Same order as analogIn[]
+const uint8_t ADC_SCAN_LIST[6] PROGMEM_MAPPED = { MUX_POT_SR, MUX_CV_SR, MUX_POT_BC, MUX_CV_BC, MUX_POT_GLIDE, MUX_CV_GLIDE };
+
 #define PIN_BTN_LOOP  PIN_PA6         // Loop Button
 #define PIN_LED_LOOP  PIN_PA7         // LED Indicator for Loop Button
 
@@ -96,8 +111,8 @@ firmware code.
 
 // Global Variables used in the Interrupt Service Routine
 volatile int16_t rot_value   = 0;                                              // current value of the rotary encoder
-volatile uint8_t rot_min     = 0;                                              // current minimum of the rotary encoder
-volatile uint8_t rot_max     = 128;                                            // current maximum of the rotary encoder
+volatile int16_t rot_min     = 0;                                              // current minimum of the rotary encoder (signed, so the checks below still work when rot_value drops below zero)
+volatile int16_t rot_max     = 128;                                            // current maximum of the rotary encoder
 volatile uint8_t rot_inc     = 1;                                              // the increment that the value increases by
 volatile bool    rot_changed = false;                                          // set to true when rotary encoder changes
 
@@ -128,7 +143,7 @@ class Hardware{
     uint16_t analogIn[6]  = {0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF,0xFFFF};       // Buffer containing all of the analog inputs
     uint8_t  digitalIn[4] = {0xFF, 0xFF, 0xFF, 0xFF};                          // Buffer containing all of the digital inputs
 
-    bool analogReadFiltered( uint16_t &val, uint8_t pin, uint8_t threshold );  // Read Analog settings trigger when things change
+    bool analogReadFiltered( uint16_t &val, uint16_t reading, uint8_t threshold ); // Filter Analog settings trigger when things change
     bool digitalReadFiltered( uint8_t &val, uint8_t pin );                     // Read Digital settings and trigger when things change
     bool updateEncoder();                                                      // Read Encoder and trigger when things change
 
@@ -146,6 +161,7 @@ class Hardware{
     void (*cb_glideChange)()        = NULL;                                    // Event function pointer for when the loop button gets pressed
 
     Adafruit_SSD1306 screen;
+    uint16_t display_pos = SCREEN_BYTES;                                       // Next frame buffer byte displayChunk() sends
 
 
   public:
@@ -186,7 +202,7 @@ class Hardware{
     void onGlideChange(      void (*fn)() ){ cb_glideChange       = fn; }      // Assign callback for adjusting the Glide Potentiometer or CV
 
     // Rotary Encoder Functions:
-    void configEncoder( uint8_t val, uint8_t min, uint8_t max, uint8_t increment );
+    void configEncoder( uint16_t val, uint16_t min, uint16_t max, uint8_t increment );
 
     // Display Functions
     uint8_t *displayBuffer(){ return screen.getBuffer(); }
@@ -195,6 +211,8 @@ class Hardware{
       screen.display(); 
       //TCA0.SINGLE.CTRLA = TCA_SINGLE_ENABLE_bm;                                 // Turn the ISR back on
     }
+    void displayBegin();                                                       // Start sending the screen buffer a chunk at a time (See displayChunk)
+    bool displayChunk();                                                       // Send the next chunk. Returns true while there is more to send
 
     void drawCStr( const char *buffer, uint8_t length, uint8_t line, uint8_t column);
     void drawCStr( const char *buffer, uint8_t length, uint8_t line){ drawCStr(buffer, length, line, 0); }
@@ -212,7 +230,7 @@ Hardware::Hardware() : screen(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET){}
 void Hardware::setup(){
   // Screen Setup
   delay(10);
-  if(!screen.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
+  if(!screen.begin(SSD1306_SWITCHCAPVCC, SCREEN_I2C)) {
     for(;;); // Don't proceed, loop forever
   }
   screen.clearDisplay();
@@ -233,6 +251,8 @@ void Hardware::setup(){
   pinMode(PIN_ROT_DN,    INPUT_PULLUP);                                        // Setup the record encoder down pin as a pull-up input
   PORTC.PIN0CTRL = 0b00001011;                                                 // Setup the interrupt, PULLUPEN = 1, ISC = 5 trigger low level
 
+  // Analog Input Setup
+  adcScanSetup( adc_pipe, ADC_SCAN_LIST, 6 );                                  // Hand the pots & CVs over to the ADC scheduler (takes a first reading of each)
 }
 
 
@@ -247,12 +267,12 @@ void Hardware::setup(){
 // the value in the analogIn array (even though that value won't carry to the setting variable). This allows us to
 // accommodate drift in the analog inputs.
 
-bool Hardware::analogReadFiltered( uint16_t &val, uint8_t pin, uint8_t threshold ){
+bool Hardware::analogReadFiltered( uint16_t &val, uint16_t reading, uint8_t threshold ){
   if( val==0xFFFF ){                               // If system just initialized, val will be set to 0xFFFF
-    val = analogRead(pin);                         // Overwrite val with the current analog value and
+    val = reading;                                 // Overwrite val with the current analog value and
     return( true );                                // Tell the system that we need to update
   }                                                // Otherwise, if everything is already initialized...
-  uint16_t vNew = (analogRead(pin) + val) >> 1;    // Average the current value with the new one
+  uint16_t vNew = (reading + val) >> 1;            // Average the current value with the new one
   if( abs( val - vNew ) > threshold ){             // See if the change is larger than threshold
     val = vNew;                                    // Update the value
     return( true );                                // Return true since we updated the value
@@ -281,7 +301,7 @@ bool Hardware::digitalReadFiltered( uint8_t &val, uint8_t pin ){
 *******************************************/
 
 //Sets up the parameters used to process the rotary encoder events
-void Hardware::configEncoder( uint8_t val, uint8_t min, uint8_t max, uint8_t increment ){
+void Hardware::configEncoder( uint16_t val, uint16_t min, uint16_t max, uint8_t increment ){
   rot_min = min;                                                               // The minimum value that the rotary encoder can select
   rot_max = max;                                                               // The maximum value that the rotary encoder can select
   rot_value = val;                                                             // The current value of the rotary encoder
@@ -322,14 +342,14 @@ void Hardware::processEvents(){
   if(t < next_update) return;                                                  // See if it is time to check for midi updates again
   next_update = t + UPDATE_PERIOD;                                             // Set the next time we need to check for midi updates
 
-  // Read the analog & digital inputs
-  TCA0.SINGLE.CTRLA &= ~TCA_SINGLE_ENABLE_bm;                                  // Turn off the ISR so it doesn't create a conflict
-  if( analogReadFiltered( analogIn[0], PIN_POT_SR,    ANALOG_READ_THRESHOLD ) ){ sampleRatePot = analogIn[0]; updateSR = true; }
-  if( analogReadFiltered( analogIn[1], PIN_CV_SR,     ANALOG_READ_THRESHOLD ) ){ sampleRateCV  = analogIn[1]; updateSR = true; }
-  if( analogReadFiltered( analogIn[2], PIN_POT_BC,    ANALOG_READ_THRESHOLD ) ){ bitCrushPot   = analogIn[2]; updateBC = true; }
-  if( analogReadFiltered( analogIn[3], PIN_CV_BC,     ANALOG_READ_THRESHOLD ) ){ bitCrushCV    = analogIn[3]; updateBC = true; }
-  if( analogReadFiltered( analogIn[4], PIN_POT_GLIDE, ANALOG_READ_THRESHOLD ) ){ glidePot      = analogIn[4]; updateGl = true; }
-  if( analogReadFiltered( analogIn[5], PIN_CV_GLIDE,  ANALOG_READ_THRESHOLD ) ){ glideCV       = analogIn[5]; updateGl = true; }
+  // Read the analog & digital inputs. The analog values come straight from the ADC scheduler (See adc.h), which
+  // converts them in the gaps between samples, so there is no need to stop the audio timer anymore.
+  if( analogReadFiltered( analogIn[0], adcScanRead( adc_pipe, 0 ), ANALOG_READ_THRESHOLD ) ){ sampleRatePot = analogIn[0]; updateSR = true; }
+  if( analogReadFiltered( analogIn[1], adcScanRead( adc_pipe, 1 ), ANALOG_READ_THRESHOLD ) ){ sampleRateCV  = analogIn[1]; updateSR = true; }
+  if( analogReadFiltered( analogIn[2], adcScanRead( adc_pipe, 2 ), ANALOG_READ_THRESHOLD ) ){ bitCrushPot   = analogIn[2]; updateBC = true; }
+  if( analogReadFiltered( analogIn[3], adcScanRead( adc_pipe, 3 ), ANALOG_READ_THRESHOLD ) ){ bitCrushCV    = analogIn[3]; updateBC = true; }
+  if( analogReadFiltered( analogIn[4], adcScanRead( adc_pipe, 4 ), ANALOG_READ_THRESHOLD ) ){ glidePot      = analogIn[4]; updateGl = true; }
+  if( analogReadFiltered( analogIn[5], adcScanRead( adc_pipe, 5 ), ANALOG_READ_THRESHOLD ) ){ glideCV       = analogIn[5]; updateGl = true; }
 
   if( cb_leftPress  && digitalReadFiltered(digitalIn[1], PIN_BTN_LEFT)  && (digitalIn[1]==0) ){ updateLP  = true; }
   if( cb_rightPress && digitalReadFiltered(digitalIn[2], PIN_BTN_RIGHT) && (digitalIn[2]==0) ){ updateRP  = true; }
@@ -342,8 +362,6 @@ void Hardware::processEvents(){
     cb_loopPress();
   }
 
-  TCA0.SINGLE.CTRLA = TCA_SINGLE_ENABLE_bm;                                    // Turn the ISR back on
-
   digitalWrite( PIN_LED_LOOP, loop );                                          // Set loop LED based on status of loop
 
   // Run callback functions if the analog values changed
@@ -379,6 +397,38 @@ void Hardware::processEvents(){
 }
 
 
+// DISPLAY NOTES:
+// • screen.display() sends the whole 1 kB frame in one go, which keeps loop() busy for about 25 mS at 400 kHz. That's
+//   longer than the block engine's dac_ring lasts (See BLOCK ENGINE NOTES in dsp.h).
+// • displayBegin() and displayChunk() send the same frame the same way the display library does (page & column window,
+//   then the pixels behind a 0x40 data prefix), but one SCREEN_CHUNK piece per call, so loop() can get other work done
+//   in between. A piece is 33 bytes on the bus, about 0.75 mS at 400 kHz.
+// • Nothing else shares the I2C bus, so the clock just stays at 400 kHz.
+
+void Hardware::displayBegin(){
+  Wire.setClock( 400000 );                                                     // The same fast clock the display library uses for a frame
+  const uint8_t window[] = { 0x00,                                             // Command stream: every page & every column, so the
+                             SSD1306_PAGEADDR,   0, 0xFF,                      // pixels that follow fill the screen from the top left
+                             SSD1306_COLUMNADDR, 0, SCREEN_WIDTH - 1 };
+  Wire.beginTransmission( SCREEN_I2C );
+  Wire.write( window, sizeof(window) );
+  Wire.endTransmission();
+  display_pos = 0;
+}
+
+bool Hardware::displayChunk(){
+  if( display_pos >= SCREEN_BYTES ) return false;
+  uint16_t count = SCREEN_BYTES - display_pos;
+  if( count > SCREEN_CHUNK ) count = SCREEN_CHUNK;
+  Wire.beginTransmission( SCREEN_I2C );
+  Wire.write( (uint8_t)0x40 );                                                 // Data stream
+  Wire.write( screen.getBuffer() + display_pos, count );
+  Wire.endTransmission();
+  display_pos += count;
+  return display_pos < SCREEN_BYTES;
+}
+
+
 void Hardware::drawCStr( const char *buffer, uint8_t length, uint8_t line, uint8_t column){
   uint8_t charSubCol = 0; //display_offset_c % CHAR_WIDTH;
   uint8_t charCol = 0;
@@ -0,0 +1,968 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+/*
+___________ __         .__
+\_   _____//  |_  ____ |  |__
+ |    __)_\   __\/ ___\|  |  \
+ |        \|  | \  \___|   Y  \
+/_______  /|__|  \___  >___|  /
+        \/           \/     \/
+ ____  __.                         .__
+|    |/ _|___________  ____   ____ |  |
+|      <_/ __ \_  __ \/    \_/ __ \|  |
+|    |  \  ___/|  | \/   |  \  ___/|  |__
+|____|__ \___  >__|  |___|  /\___  >____/
+        \/   \/           \/     \/
+
+ETCH Firmware source code designed to run on the AVR128DA28.
+Copyright (C) 2024 Tyler Klein (Things Made Simple)
+Etch Hardware Design by Juanito Moore (Modular for the Masses)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+--- Description: ---
+This library contains the per-sample math of the Etch Module (bit-crush, the
+resonant 4-pole filter, reverb, glide and scale quantizing). It has no
+dependencies on the AVR registers or the Arduino core, so the exact same
+fixed-point code runs inside the ISR in dsp.h and on a desktop computer in
+the etch-render tool (see tools/etch-render).
+
+*/
+
+
+/*******************************************
+* Host Compatibility                       *
+*******************************************/
+
+#ifndef ARDUINO                                                 // When compiled outside of the Arduino environment we need to
+#include <stdint.h>                                             // provide the handful of helpers that the Arduino core normally gives us
+#include <stdlib.h>
+#include <math.h>
+#ifndef constrain
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#endif
+#endif
+
+// Clock & period settings:
+#define M_CLOCK_FRQ   25000000                                   // Master Clock Frequency of the AVR Microcontroller
+#define LOW_SAMP_FRQ  32                                         // The lowest frequency for audio sample rate (it goes up from here with the input)
+
+#define OCT_RANGE     9                                          // Number of octaves in the sample rate range
+#define UNITS_PER_OCT (1024/OCT_RANGE)                           // Number of units per octave
+#define PITCH_STEPS   256                                        // Sample rate pitch steps per octave (See kernelPhaseInc)
+
+#define KERNEL_BITCRUSH_SIZE 1024                               // Number of entries in the bitcrush lookup table (one per 10-bit ADC value)
+#define BITCRUSH_TABLE true                                     // Set to false to bitcrush with arithmetic instead of lookup tables (saves 4 kB of RAM, costs a multiply per sample)
+#define REVERB_PACKED  true                                     // Set to false to store the reverb in plain 16-bit words (fewer instructions per access, but 5/8 of the delay time)
+#define LOOP_MULAW     true                                     // Set to false to store audio loops in plain 16-bit words (exact, but half as long)
+
+// Loop playback interpolation (See LOOP RESAMPLER NOTES):
+#define LOOP_INTERP_NONE   0                                    // Drop-sample: just play the nearest older sample
+#define LOOP_INTERP_LINEAR 1                                    // Straight line between the two samples around the read pointer
+#define LOOP_INTERP_CUBIC  3                                    // Catmull-Rom curve through the four samples around the read pointer
+#define LOOP_INTERP        LOOP_INTERP_LINEAR                   // Which one the audio loop uses
+#define LOOP_PITCH_RANGE   24                                   // Loop Pitch goes this many semitones down and up
+
+// Morph grain settings (See SOUND MORPHING NOTES):
+#define MORPH_GRAINS 4                                          // Slots the loop gets split into, each with its own crossfade (1 is a plain two buffer morph)
+#define MORPH_SLEW   4                                          // The weight moves 1/16 of the way to the next grain's weight every sample (about 1 mS)
+
+// Reverb network settings (See REVERB NOTES):
+#define REVERB_TAPS         4                                   // Comb taps on the main delay line (power of 2, so averaging them is a shift)
+#define REVERB_TAP_SHIFT    2                                   // log2( REVERB_TAPS )
+#define REVERB_AP1          113                                 // Allpass diffuser lengths in samples (both prime, about 9 mS and 3 mS at 12.5 kHz)
+#define REVERB_AP2          37
+#define REVERB_ALLPASS_SIZE (REVERB_AP1 + REVERB_AP2)           // Samples at the end of the reverb buffer that the diffusers use
+#define REVERB_GLIDE_SHIFT  11                                  // Read heads cover 1/2048 of the way to a new delay every sample (about 160 mS at 12.5 kHz)
+#define REVERB_GLIDE_MAX    64                                  // Fastest a read head moves, in 1/256 samples per sample (bends the pitch by 25% at most)
+
+#if REVERB_PACKED
+typedef uint8_t  KernelReverbCell;                              // The reverb buffer is raw bytes with 4 samples packed into every 5 (See PACKED REVERB NOTES)
+#else
+typedef uint16_t KernelReverbCell;                              // One 16-bit word per reverb sample
+#endif
+
+#if LOOP_MULAW
+typedef uint8_t  KernelLoopCell;                                // Audio loop samples are 8-bit mu-law codes (See LOOP STORAGE NOTES)
+#else
+typedef uint16_t KernelLoopCell;                                // Audio loop samples are plain 10-bit values in 16-bit words
+#endif
+
+// RAM a reverb buffer of n samples takes up (in bytes). n must be a multiple of 4 when the reverb is packed
+constexpr uint16_t kernelReverbBytes( uint16_t n ){ return REVERB_PACKED ? (n >> 2) * 5 : n * 2; }
+
+// Note settings:
+#define KERNEL_NOTES   121                                      // Notes the CV output can reach (10 octaves, 0...120)
+#define KERNEL_OCTAVES 10                                       // Octaves in the CV output range (one calibration segment each)
+
+// Glide settings:
+#define GLIDE_MAX_MS  4096                                      // Glide time constant with the Filter knob all the way down (in mS)
+#define GLIDE_OCTAVES 12                                        // Number of doublings the knob covers, so the shortest glide is GLIDE_MAX_MS / 2^12 = 1 mS
+
+
+/*******************************************
+* Tween Functions                          *
+*******************************************/
+
+// TWEEN FUNCTION NOTES
+// • The tween array is a pre-calculated function that provides a smooth "S-curve" transition that eases in and eases out
+// • This conversion is used to transition smoothly from one input "grain" to the next in the morph function
+// • It stays in the mapped flash and costs no RAM (See MEMORY NOTES in dsp.h)
+
+const uint8_t TWEEN_FN[257] PROGMEM_MAPPED = {
+0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x01,0x01,0x02,0x02,
+0x02,0x03,0x03,0x04,0x04,0x04,0x05,0x05,0x06,0x06,0x07,0x07,0x08,0x09,0x09,0x0A,
+0x0B,0x0B,0x0C,0x0D,0x0D,0x0E,0x0F,0x10,0x10,0x11,0x12,0x13,0x14,0x15,0x15,0x16,
+0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,0x20,0x21,0x22,0x23,0x24,0x25,0x27,
+0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2F,0x30,0x31,0x32,0x33,0x35,0x36,0x37,0x38,0x3A,
+0x3B,0x3C,0x3E,0x3F,0x40,0x42,0x43,0x44,0x46,0x47,0x48,0x4A,0x4B,0x4D,0x4E,0x4F,
+0x51,0x52,0x54,0x55,0x56,0x58,0x59,0x5B,0x5C,0x5E,0x5F,0x61,0x62,0x63,0x65,0x66,
+0x68,0x69,0x6B,0x6C,0x6E,0x6F,0x71,0x72,0x74,0x75,0x77,0x78,0x7A,0x7B,0x7D,0x7E,
+0x80,0x81,0x83,0x84,0x86,0x87,0x89,0x8A,0x8C,0x8D,0x8F,0x90,0x92,0x93,0x95,0x96,
+0x98,0x99,0x9B,0x9C,0x9D,0x9F,0xA0,0xA2,0xA3,0xA5,0xA6,0xA8,0xA9,0xAA,0xAC,0xAD,
+0xAF,0xB0,0xB1,0xB3,0xB4,0xB6,0xB7,0xB8,0xBA,0xBB,0xBC,0xBE,0xBF,0xC0,0xC2,0xC3,
+0xC4,0xC6,0xC7,0xC8,0xC9,0xCB,0xCC,0xCD,0xCE,0xCF,0xD1,0xD2,0xD3,0xD4,0xD5,0xD6,
+0xD7,0xD9,0xDA,0xDB,0xDC,0xDD,0xDE,0xDF,0xE0,0xE1,0xE2,0xE3,0xE4,0xE5,0xE6,0xE7,
+0xE8,0xE9,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xEE,0xEF,0xF0,0xF1,0xF1,0xF2,0xF3,0xF3,
+0xF4,0xF5,0xF5,0xF6,0xF7,0xF7,0xF8,0xF8,0xF9,0xF9,0xFA,0xFA,0xFA,0xFB,0xFB,0xFC,
+0xFC,0xFC,0xFD,0xFD,0xFD,0xFD,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFE,0xFF, 0xFF
+};
+
+
+/* various other tween functions where dist goes from 0 to 63, or 0 to 127. In the end I used 0 to 255
+#define TWEEN( v1, v2, dist, max ){ int16_t((((int32_t(v2)-int32_t(v1)) * (dist)) / (max)) + (v1)) }
+#define TWEEN64(  v1, v2, dist ){ uint16_t( ( uint32_t(v2) * uint8_t(dist) + uint32_t(v1) * (  63-uint8_t(dist) ) ) >> 6 ) }
+#define TWEEN128( v1, v2, dist ){ uint16_t( ( uint32_t(v2) * uint8_t(dist) + uint32_t(v1) * ( 127-uint8_t(dist) ) ) >> 7 ) }
+*/
+// TWEEN256_POS takes a weighted average between v1 and v2 when v2 > v1
+#define TWEEN256_POS( v1, v2, dist ) ( uint16_t(v1) + uint16_t((uint32_t(uint16_t(v2)-uint16_t(v1)) * uint32_t(dist)) >> 8) )
+
+// TWEEN256_NEG takes a weighted average between v1 and v2 when v1 > v2
+#define TWEEN256_NEG( v1, v2, dist ) ( uint16_t(v1) - uint16_t((uint32_t(uint16_t(v1)-uint16_t(v2)) * uint32_t(dist)) >> 8) )
+
+// TWEEN256 figures out which POS/NEG function to use to take a weighted average between v1 and v2
+#define TWEEN256( v1, v2, dist )     ( ( uint16_t(v2)>uint16_t(v1) ) ? TWEEN256_POS(v1,v2,dist) : TWEEN256_NEG(v1,v2,dist) )
+
+
+/*******************************************
+* QUANTIZING DEFINITIONS                   *
+*******************************************/
+// Scale Probabilities
+#define UNITS_PER_NOTE (1024/120)
+
+#define SCALE_PROB_RANGE 250                                    // Determines the randomization of the scale thresholds for weighted scales
+
+// SCALE NOTES:
+// • SCALE_PROB stays in the mapped flash (See MEMORY NOTES in dsp.h).
+// • The ISR never looks at the weights directly. Whenever the scale or the crush changes, kernelScale() sorts the 12 notes
+//   into "always in", "never in" and "maybe in" (the weighted notes close enough to the crush threshold that the random
+//   draw decides), and works out the 8-bit cut-off each maybe note has to beat.
+// • Each CV step then starts from the always mask and rolls one random byte per maybe note, which leaves a 12-bit
+//   scale_mask (bit 0 = C ... bit 11 = B). For the fixed scales there's usually nothing to roll at all.
+
+const int16_t SCALE_PROB[22][12] PROGMEM_MAPPED = {
+/*  C    C#   D    D#   E    F    F#   G    G#   A    A#   B */
+  { 635, 635, 635, 635, 635, 635, 635, 635, 635, 635, 635, 635 }, // Chromatic
+  { 635,   0, 635,   0, 635, 635,   0, 635,   0, 635,   0, 635 }, // Major Quantized
+  { 635, 223, 348, 233, 438, 409, 252, 519, 239, 366, 229, 288 }, // Major Weighted
+  { 635,   0, 635, 635,   0, 635,   0, 635, 635,   0, 635,   0 }, // Minor Quantized
+  { 635, 268, 352, 538, 260, 353, 254, 475, 398, 259, 334, 317 }, // Minor Weighted
+  { 635,   0,   0, 635,   0,   0, 635,   0,   0, 635,   0,   0 }, // Diminished
+  { 635,   0, 635,   0, 635,   0, 635,   0, 635,   0, 635,   0 }, // Whole Tone
+  { 635,   0, 635, 635,   0, 635,   0, 635,   0, 635, 635,   0 }, // Dorian
+  { 635,   0,   0, 635,   0, 635, 635, 635,   0,   0, 635,   0 }, // Blues
+  { 635,   0, 635,   0, 635, 635,   0, 635,   0, 635, 635,   0 }, // Mixolydian
+  { 635,   0, 635, 635,   0,   0, 635, 635, 635,   0,   0, 635 }, // Hungarian
+  { 635,   0,   0, 635,   0, 635,   0, 635,   0,   0, 635,   0 }, // Pentatonic
+//{ 635,   0, 635, 635,   0, 635,   0, 635,   0, 635,   0, 635 }, // Melodic Minor
+  { 635,   0, 352, 538,   0, 353,   0, 475,   0, 500,   0, 475 }, // Melodic Minor (Weighted)
+  { 635,   0, 635,   0, 635, 635, 635,   0, 635,   0, 635,   0 }, // Arabian
+  { 635, 635,   0, 635,   0,   0,   0, 635, 635,   0,   0,   0 }, // Balinese
+  { 635, 635,   0,   0, 635, 635,   0, 635, 635,   0, 635,   0 }, // Spanish Gypsy
+  { 635, 635,   0,   0, 635, 635, 635,   0,   0, 635, 635,   0 }, // Oriental
+  { 635,   0, 635,   0, 635,   0, 635,   0,   0, 635, 635,   0 }, // Prometheus
+  { 635, 635,   0,   0,   0, 635,   0, 635,   0,   0, 635,   0 }, // Japanese
+  { 635,   0, 635,   0,   0, 635,   0, 635,   0,   0, 635,   0 }, // Egyptian
+  { 635, 635,   0,   0, 635, 635,   0, 635,   0,   0, 635,   0 }, // Iberian
+  { 635,   0, 635, 635,   0,   0, 635, 635,   0, 635, 635,   0 }  // Romanian
+};
+
+
+
+// Quantize Modes (Quant Mode menu setting)
+#define QUANT_NEAREST 0                                         // Snap to the closest note in the scale
+#define QUANT_UP      1                                         // Snap to the next note up in the scale
+#define QUANT_DOWN    2                                         // Snap to the next note down in the scale
+
+// QUANT TABLE NOTES:
+// • Rotating the 12-bit scale mask so the incoming note lands on bit 0 leaves a 12-bit number that says everything
+//   there is to know about where the neighbouring scale notes are. QUANT_STEPS is indexed by that number.
+// • Each entry packs the distance (in semitones) up to the nearest scale note in the high nibble and down to the nearest
+//   scale note in the low nibble. A distance of 0 means the incoming note is already in the scale.
+// • The table is built by the compiler and kept in the mapped flash, so it's 4 kB of flash and no RAM or boot time.
+
+struct KernelQuantTable {
+  uint8_t steps[4096];
+  constexpr KernelQuantTable() : steps() {
+    for( uint16_t mask = 1; mask < 4096; mask++ ){              // Mask 0 (no notes at all) is left as 0 and gets caught by the kernel
+      uint8_t up = 0, down = 0;
+      while( !(mask & (1 << up)) ) up++;
+      while( !(mask & (1 << ((12 - down) % 12))) ) down++;
+      steps[mask] = (up << 4) | down;
+    }
+  }
+};
+
+constexpr KernelQuantTable QUANT_STEPS PROGMEM_MAPPED;
+
+// NOTE_LEVEL is the ideal 0...1023 level for each note (what the screen and the morph buffer show). The DAC
+// doesn't use it directly, it goes through the calibrated note_dac table instead (See kernelNoteTable)
+struct KernelNoteLevels {
+  uint16_t level[KERNEL_NOTES];
+  constexpr KernelNoteLevels() : level() {
+    for( uint8_t n = 0; n < KERNEL_NOTES; n++ ) level[n] = n < 120 ? (uint32_t(n) << 10) / 120 : 1023;
+  }
+};
+
+constexpr KernelNoteLevels NOTE_LEVEL PROGMEM_MAPPED;
+
+
+
+/*******************************************
+* Kernel State & Parameters                *
+*******************************************/
+
+// KernelScale holds the current scale, pre-sorted for the quantizer (See kernelScale)
+struct KernelScale {
+  uint16_t always;                                              // Notes that are always in the scale (bit 0 = C ... bit 11 = B)
+  uint16_t maybe;                                               // Notes that are only in the scale when their random draw beats cut[]
+  uint8_t  cut[12];                                             // Smallest random byte that lets each maybe note into the scale
+};
+
+// KernelInputCal is the audio input's measured offset and gain error (See DSP::calibrateInput)
+struct KernelInputCal {
+  int16_t  offset;                                              // How far the input's resting point reads from 0x200 (in ADC counts)
+  uint16_t gain;                                                // Gain correction (out of 4096, so 4096 leaves the input alone)
+};
+
+// KernelParams holds the settings the per-sample functions read but never write. They
+// are set from the main loop through the DSP::setXXX functions (or the etch-render options)
+struct KernelParams {
+  const uint16_t *bitcrush;                                     // Bitcrush conversion table for the current bitcrush setting
+  const uint16_t *note_dac;                                     // DAC0.DATA value for each CV note 0...120 (See kernelNoteTable)
+  KernelReverbCell *reverb_buffer;                              // Reverb buffer that keeps track of the sample history (See kernelReverbRead)
+  uint16_t  reverb_size;                                        // Number of elements in the reverb buffer
+  uint16_t  reverb_delay;                                       // Longest comb tap in samples (the Reverb Delay setting scaled to the delay line)
+  uint8_t   reverb_feedback;                                    // Percentage mix of feedback (out of 256)
+  uint8_t   reverb_wet_mix;                                     // Percentage mix of original signal (out of 256)
+  uint8_t   resonance;                                          // Amount of the inverted output that gets fed back into the filter
+  uint16_t  alpha;                                              // Pre-calculated filter weight: cutoff / ( (sampleRate/(2*Pi)) + cutOff) * 255
+  uint16_t  glide;                                              // One-pole glide coefficient for CV mode (out of 65536 per CV step, See kernelGlideCoef)
+  int16_t   scale_crush;                                        // Holds the current value of the scale_crush setting used in CV mode
+  uint8_t   scale_index;                                        // This is the current scale that notes are being quantized to
+  uint8_t   note_offset;                                        // The amount to offset the notes by (transposition)
+  uint8_t   quant_mode;                                         // Which way notes snap to the scale: QUANT_NEAREST, QUANT_UP or QUANT_DOWN
+  KernelScale scale;                                            // scale_index and scale_crush sorted into note masks (See kernelScale)
+  uint16_t  reverb_taps[REVERB_TAPS];                           // Delay of each comb tap in samples, all mutually prime (See kernelReverbDelay)
+#if !BITCRUSH_TABLE
+  uint16_t  crush_step;                                         // Distance between the points where the crushed value jumps (See kernelBitCrushArith)
+  uint16_t  crush_add;                                          // Amount added to every crushed value (bc>>2)
+  uint32_t  crush_recip;                                        // 2^20 / crush_step (rounded up), so dividing by crush_step is a multiply and a shift
+  KernelInputCal input_cal;                                     // Input correction (the tables fold this in instead)
+#endif
+};
+
+// KernelState holds everything the per-sample functions carry from one sample to the next
+struct KernelState {
+  uint16_t rolling_avg;                                         // Resonance stage of the filter
+  uint16_t rolling_avg2;                                        // Filter stage 1
+  uint16_t rolling_avg3;                                        // Filter stage 2
+  uint16_t rolling_avg4;                                        // Filter stage 3
+  uint16_t rolling_avg5;                                        // Filter stage 4
+  uint16_t reverb_write_index;                                  // Current write position within the main reverb delay line
+  uint16_t reverb_ap_index[2];                                  // Current position within each allpass diffuser
+  uint32_t reverb_head[REVERB_TAPS];                            // Where each comb tap is actually reading (samples behind the write head, 8 fractional bits)
+  uint16_t glide_avg;                                           // Glide average in CV mode (10-bit value with 5 extra bits of precision)
+  uint16_t scale_mask;                                          // Notes that made it into the scale on the last CV step (bit 0 = C ... bit 11 = B)
+  uint16_t rng;                                                 // xorshift state for the weighted scales (must never be zero)
+};
+
+// Puts the state back to where it is at power-on (everything centered at the middle value)
+inline void kernelReset( KernelState &s ){
+  s.rolling_avg  = 0x200;
+  s.rolling_avg2 = 0x200;
+  s.rolling_avg3 = 0x200;
+  s.rolling_avg4 = 0x200;
+  s.rolling_avg5 = 0x200;
+  s.reverb_write_index = 0;
+  s.reverb_ap_index[0] = 0;
+  s.reverb_ap_index[1] = 0;
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ) s.reverb_head[k] = 0;
+  s.glide_avg  = 0x200 << 5;
+  s.scale_mask = 0;
+  s.rng = 0xACE1;
+}
+
+// Random byte for the weighted scales. A 16-bit xorshift is just a handful of shifts and XORs, so it's cheap
+// enough to call for every weighted note inside the ISR (unlike random())
+inline uint8_t kernelRandom( KernelState &s ){
+  s.rng ^= s.rng << 7;
+  s.rng ^= s.rng >> 9;
+  s.rng ^= s.rng << 8;
+  return s.rng >> 8;                                            // The top byte is the most random
+}
+
+
+/*******************************************
+* Setting Conversions                      *
+*******************************************/
+
+// Works out 2^x for 0 <= x < 32 without pow(), so it can run at compile time. The whole octaves are a shift and the
+// fraction goes through the e^y series, which is well past float precision after 12 terms for 0 <= y < ln 2
+constexpr double kernelExp2( double x ){
+  uint8_t whole = uint8_t(x);
+  double  y     = (x - whole) * 0.693147180559945309;           // 2^f = e^(f ln 2)
+  double  term  = 1, sum = 1;
+  for( uint8_t n = 1; n < 12; n++ ){ term *= y / n; sum += term; }
+  return sum * double(uint32_t(1) << whole);
+}
+
+// SAMPLE RATE NOTES:
+// • TCA0 ticks at one fixed rate (See ISR_TICK_PERIOD in dsp.h), so the ISR load, the ADC rate and the DAC update rate never
+//   move. The Rate knob drives a 32-bit phase accumulator instead: every tick adds phase_inc, and a new sample only gets taken
+//   (and then held) on the ticks where the phase rolls over. That's phase_inc / 2^32 samples per tick.
+// • The rate is set as a pitch in 1/PITCH_STEPS octave steps above LOW_SAMP_FRQ. The whole octaves are a shift and the
+//   fraction comes out of a one octave table, which is the usual way to get 1v/oct out of an exponential converter.
+// • Nothing ever rewrites TCA0.SINGLE.PER mid-cycle, so sweeping the rate can't glitch the timer, and the rate is no longer
+//   rounded to a whole number of timer ticks. Rates past the tick rate just run the kernel on every tick.
+
+// KernelPhaseTable is the phase increment for the bottom octave (LOW_SAMP_FRQ and up) at every 1/PITCH_STEPS of an octave
+// for a timer that ticks every tick_period clock cycles. It is built by the compiler
+struct KernelPhaseTable {
+  uint32_t inc[PITCH_STEPS];
+  constexpr KernelPhaseTable( uint16_t tick_period ) : inc() {
+    for( uint16_t i = 0; i < PITCH_STEPS; i++ )
+      inc[i] = uint32_t( 4294967296.0 * LOW_SAMP_FRQ * tick_period / M_CLOCK_FRQ * kernelExp2( double(i) / PITCH_STEPS ) );
+  }
+};
+
+// Converts a 0...1023 sample rate setting into a pitch (1/PITCH_STEPS octaves above LOW_SAMP_FRQ)
+inline uint16_t kernelRatePitch( uint16_t sr ){
+  return ( uint32_t(sr) * OCT_RANGE * PITCH_STEPS ) >> 10;
+}
+
+// Phase increment for a pitch. Saturates at one sample per tick once the pitch goes past the tick rate
+inline uint32_t kernelPhaseInc( const KernelPhaseTable &t, uint16_t pitch ){
+  uint8_t  oct = pitch / PITCH_STEPS;
+  uint32_t inc = t.inc[pitch % PITCH_STEPS];
+  if( oct >= 32 || inc > (0xFFFFFFFF >> oct) ) return 0xFFFFFFFF;
+  return inc << oct;
+}
+
+// Adds one tick's worth of phase. Returns true when it rolls over (time to take a new sample)
+inline bool kernelPhaseStep( uint32_t &phase, uint32_t inc ){
+  uint32_t next = phase + inc;
+  bool wrapped = next < phase;
+  phase = next;
+  return wrapped;
+}
+
+// Average number of timer clock cycles between samples for a phase increment (float math, so keep it out of the ISR)
+inline uint32_t kernelPhaseTicks( uint32_t inc, uint16_t tick_period ){
+  return inc ? uint32_t( 4294967296.0 * tick_period / inc ) : 0xFFFFFFFF;
+}
+
+// Corrects a raw 0...1023 audio input reading for the input's offset and gain error
+inline uint16_t kernelInputCorrect( const KernelInputCal &cal, uint16_t raw ){
+  int32_t v = 0x200 + ( ( (int32_t(raw) - 0x200 - cal.offset) * cal.gain ) >> 12 );
+  return v < 0 ? 0 : ( v > 0x3FF ? 0x3FF : v );
+}
+
+// BITCRUSH TABLE NOTES:
+// • Every audio sample already goes through the bitcrush table, so the input correction gets folded into it for free. Each
+//   entry is crushed from the corrected reading instead of the raw one.
+// • The crushed value holds at the last "reset" point below the reading, and the reset points are spaced (bc>>1)+1 apart.
+//   The corrected readings only ever go up as the raw reading goes up, so the reset points can be walked along in one pass.
+// • The table can be built a few entries at a time (See DSP::buildBitCrush), so a crush sweep never holds up loop() for
+//   long. KernelCrushBuild keeps track of where the build is at in between calls.
+// • A build that's underway always runs to the end. A new setting that comes in meanwhile just gets queued (the latest one
+//   wins) and starts once the table is swapped in, so a knob or CV that never sits still can't keep restarting the build
+//   from the top and freeze the crush. The front table is never more than one build behind.
+
+// KernelCrushBuild is a bitcrush table that's partway through being built
+struct KernelCrushBuild {
+  uint16_t bc;                                                  // Bit crush setting being built
+  uint16_t index;                                               // Next table entry to fill in
+  uint16_t step;                                                // Distance between the points where the crushed value jumps
+  uint16_t reset;                                               // Next point where the crushed value jumps
+  uint16_t val;                                                 // Current crushed value (before adding bc>>2)
+  uint16_t next_bc;                                             // Setting that came in while this one was being built
+  bool     building;                                            // A table is partway through being built
+  bool     queued;                                              // next_bc is waiting for the current build to finish
+};
+
+// Starts building a bitcrush table for a bit crush setting of 0...1023
+inline void kernelBitCrushBegin( KernelCrushBuild &b, uint16_t bc ){
+  b.bc    = bc;
+  b.index = 0;
+  b.step  = (bc>>1) + 1;
+  b.reset = b.step - 1;
+  b.val   = 0;
+}
+
+// Asks for a table for a new bit crush setting. Starts building it right away if nothing else is, otherwise queues it
+// behind the build that's underway (See BITCRUSH TABLE NOTES)
+inline void kernelBitCrushRequest( KernelCrushBuild &b, uint16_t bc ){
+  if( b.building ){
+    b.next_bc = bc;
+    b.queued  = true;
+    return;
+  }
+  kernelBitCrushBegin( b, bc );
+  b.building = true;
+}
+
+// Call once a finished table has been swapped in. Starts on the queued setting, if there is one
+inline void kernelBitCrushDone( KernelCrushBuild &b ){
+  b.building = false;
+  if( b.queued ){
+    b.queued = false;
+    kernelBitCrushRequest( b, b.next_bc );
+  }
+}
+
+// Fills in up to count more entries (with the input correction folded in). Returns true once the whole table is done
+inline bool kernelBitCrushBuild( KernelCrushBuild &b, uint16_t *table, const KernelInputCal &cal, uint16_t count ){
+  for( ; count && (b.index < KERNEL_BITCRUSH_SIZE); count--, b.index++ ){
+    uint16_t in = kernelInputCorrect( cal, b.index );
+    while( b.reset < in ){ b.val = b.reset; b.reset += b.step; } // Catch up to the corrected reading
+    uint16_t crushed = b.val + (b.bc>>2);
+    table[b.index] = crushed < 0x3FF ? crushed : 0x3FF;
+  }
+  return b.index >= KERNEL_BITCRUSH_SIZE;
+}
+
+// Fills the whole 1024 element bitcrush table in one go
+inline void kernelBitCrushTable( uint16_t *table, uint16_t bc, const KernelInputCal &cal ){
+  KernelCrushBuild b;
+  kernelBitCrushBegin( b, bc );
+  kernelBitCrushBuild( b, table, cal, KERNEL_BITCRUSH_SIZE );
+}
+
+#if !BITCRUSH_TABLE
+// Sets up the arithmetic bitcrush for a bit crush setting of 0...1023. The crushed value of a reading is the last jump point
+// below it, which works out to (in / step) * step - 1. 2^20 is the smallest power of 2 where the rounded up reciprocal gives
+// the exact same answer as dividing for every 10-bit reading and every step
+inline void kernelBitCrushArith( KernelParams &p, uint16_t bc, const KernelInputCal &cal ){
+  p.crush_step  = (bc>>1) + 1;
+  p.crush_add   = bc>>2;
+  p.crush_recip = ( (uint32_t(1) << 20) + p.crush_step - 1 ) / p.crush_step;
+  p.input_cal   = cal;
+}
+#endif
+
+// Bitcrushes a raw 0...1023 input reading, either with a table lookup or with the arithmetic version
+inline uint16_t kernelBitCrush( const KernelParams &p, uint16_t val ){
+#if BITCRUSH_TABLE
+  return p.bitcrush[val];
+#else
+  uint16_t in = kernelInputCorrect( p.input_cal, val );
+  uint16_t q  = ( uint32_t(in) * p.crush_recip ) >> 20;         // in / crush_step
+  uint16_t crushed = ( q ? q * p.crush_step - 1 : 0 ) + p.crush_add;
+  return crushed < 0x3FF ? crushed : 0x3FF;
+#endif
+}
+
+// Converts the 0...1023 filter knob into the audio mode filter weight
+inline void kernelAlpha( KernelParams &p, uint16_t gl ){
+  uint16_t a = ((gl >> 2) * uint16_t(255) ) / ( uint16_t(64) + (gl >> 2) );
+  p.alpha = a < 255 ? a : 255;                                  // Sets the value of the filter
+}
+
+// Sorts the notes of a scale into always/maybe masks for a 0...1023 scale crush setting. A note is in the scale when
+// its weight plus a random offset of -125...124 beats 1023 - scale_crush. That offset comes from a random byte b as
+// (b * SCALE_PROB_RANGE >> 8) - 125, so the test can be flipped around into "b >= cut" with cut worked out here.
+inline void kernelScale( KernelScale &sc, uint8_t scale_index, int16_t scale_crush ){
+  sc.always = 0;
+  sc.maybe  = 0;
+  for( uint8_t i = 0; i<12; i++ ){
+    int16_t t = (1023 - scale_crush) + (SCALE_PROB_RANGE>>1) - SCALE_PROB[scale_index][i]; // The random offset has to be bigger than this
+    sc.cut[i] = 0;
+    if( t < 0 ){ sc.always |= uint16_t(1) << i; continue; }    // Even the lowest draw gets in
+    if( t >= SCALE_PROB_RANGE - 1 ) continue;                   // Even the highest draw can't get in
+    sc.maybe |= uint16_t(1) << i;
+    sc.cut[i] = ( uint16_t(t + 1) * 256 + SCALE_PROB_RANGE - 1 ) / SCALE_PROB_RANGE; // Smallest b where (b * RANGE) >> 8 > t
+  }
+}
+
+// CV OUTPUT CALIBRATION NOTES:
+// • The calibration is stored as one DAC0.DATA value per octave boundary (KERNEL_OCTAVES + 1 of them). Each pair of
+//   neighbouring points is the gain and offset of one octave, so a bow in the output stage gets corrected octave by octave.
+// • kernelNoteTable() expands those points into a note -> DAC0.DATA table, so the ISR just looks the note up.
+
+// Fills in the octave points for an uncalibrated module (a straight line from 0v to the top of the DAC)
+inline void kernelOctavePoints( uint16_t *points ){
+  for( uint8_t o = 0; o <= KERNEL_OCTAVES; o++ ){
+    uint32_t v = (uint32_t(o) << 16) / KERNEL_OCTAVES;
+    points[o] = v < 0xFFC0 ? v : 0xFFC0;
+  }
+}
+
+// Expands the octave points into the note -> DAC0.DATA table by interpolating the 12 notes of each octave
+inline void kernelNoteTable( uint16_t *table, const uint16_t *points ){
+  for( uint8_t n = 0; n < KERNEL_NOTES; n++ ){
+    uint8_t o = n / 12;
+    uint8_t f = n % 12;
+    if( o >= KERNEL_OCTAVES ){ table[n] = points[KERNEL_OCTAVES]; continue; }
+    int32_t span = int32_t(points[o+1]) - int32_t(points[o]);
+    table[n] = points[o] + (span * f) / 12;
+  }
+}
+
+// GLIDE NOTES:
+// • Glide is a one-pole smoother: every CV step moves the average a fixed fraction of the way to the input. That fraction
+//   is 1 - e^(-step/tau), so the glide has the same time constant (tau) no matter how often the CV gets stepped.
+// • The Filter knob sets tau exponentially from GLIDE_MAX_MS (all the way down) to 1 mS, and turns glide off at the top.
+// • All of the float math happens here, from loop(), whenever the knob or the step rate changes. The ISR just does one
+//   16 x 16 multiply and a shift (See kernelCVNote).
+
+// Converts the 0...1023 filter knob into the glide coefficient (out of 65536) for a CV step every step_ticks TCA0 ticks
+inline uint16_t kernelGlideCoef( uint16_t gl, uint32_t step_ticks ){
+  uint16_t amount = 1023 - gl;                                  // The knob is inverted: all the way up is no glide at all
+  if( amount < 16 ) return 0xFFFF;
+  float tau = GLIDE_MAX_MS * 0.001 * pow(2, float(amount) * GLIDE_OCTAVES / 1024 - GLIDE_OCTAVES); // Time constant in seconds
+  float k   = 1 - exp( -(float(step_ticks) / M_CLOCK_FRQ) / tau );                                 // Fraction of the way to go per step
+  if( k >= 0xFFFF / 65536.0 ) return 0xFFFF;
+  return k * 65536 < 1 ? 1 : uint16_t( k * 65536 );            // Never let it get stuck completely
+}
+
+// Length of each comb tap relative to the longest one (out of 256). Spread out like the comb lengths in a Moorer reverb
+const uint16_t REVERB_TAP_RATIO[REVERB_TAPS] PROGMEM_MAPPED = { 256, 230, 211, 188 };
+
+// Greatest common divisor (for keeping the comb taps mutually prime)
+inline uint16_t kernelGCD( uint16_t a, uint16_t b ){
+  while( b ){ uint16_t t = a % b; a = b; b = t; }
+  return a;
+}
+
+// Spreads the comb taps out behind the write head for the 0...255 delay setting. Each tap gets nudged down until it
+// shares no factors with the taps before it, so their echoes never pile up on the same samples. This does a handful
+// of divides, so only call it when the setting changes (See DSP::setReverbDelay)
+inline void kernelReverbDelay( KernelParams &p, uint8_t delay ){
+  uint16_t line = p.reverb_size - REVERB_ALLPASS_SIZE;          // The allpass diffusers live at the end of the buffer
+  p.reverb_delay = ( uint32_t(delay) * line ) >> 8;             // Scale reverb delay to 0...line to match the buffer size
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ){
+    uint16_t d = ( uint32_t(p.reverb_delay) * REVERB_TAP_RATIO[k] ) >> 8;
+    if( d < 1 ) d = 1;                                          // A tap can't read the sample that's being written
+    while( d > 1 ){
+      uint8_t j = 0;
+      while( (j < k) && (kernelGCD( d, p.reverb_taps[j] ) == 1) ) j++;
+      if( j == k ) break;                                       // No common factors with any of the taps so far
+      d--;
+    }
+    p.reverb_taps[k] = d;
+  }
+}
+
+// Jumps the read heads straight to the taps instead of gliding there. Only for when the buffer has just been cleared
+// (a new layout or power-on), since anywhere else the jump would click
+inline void kernelReverbSnap( KernelState &s, const KernelParams &p ){
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ) s.reverb_head[k] = uint32_t(p.reverb_taps[k]) << 8;
+}
+
+
+/*******************************************
+* Per-Sample Functions                     *
+*******************************************/
+
+// LOW FREQUENCY FILTER NOTES:
+// • The filter first takes a weighted average of the input and the inverted output (x2) from the last sample with the input to create feedback loop
+// • The next four filter stages act like independent filter poles by taking a weighted average between the prior value and the new value.
+// • The value of alpha is derived from the "cutoff / ( sampleRate/(2*PI) + cutoff )" formula. Since I don't really care about the exact cutoff frequency
+//   I just use: 255 * cutoff / (128 + cutoff ) which seems to give a decent--if imprecise--filter range.
+
+inline uint16_t kernelFilter( KernelState &s, const KernelParams &p, uint16_t in ){
+  // FEEDBACK / RESONANCE STAGE
+  uint16_t val = uint16_t(in + uint16_t(0x7FF) - uint16_t(s.rolling_avg5 << 1)) << 2; // Add together the input with the inverted feedback
+  val = constrain( val, uint16_t(0x1600), uint16_t(0x19FF) ) - 0x1600;                 // Scale up the resonance signal by a factor of 4x and re-center
+  s.rolling_avg  = TWEEN256( in, val, p.resonance );                                   // Take a weighted average between the current input and the full feedback level
+
+  // LOW PASS FILTER STAGES
+  s.rolling_avg2 = TWEEN256( s.rolling_avg2, s.rolling_avg,  p.alpha );               // FILTER STAGE 1
+  s.rolling_avg3 = TWEEN256( s.rolling_avg3, s.rolling_avg2, p.alpha );               // FILTER STAGE 2
+  s.rolling_avg4 = TWEEN256( s.rolling_avg4, s.rolling_avg3, p.alpha );               // Filter Stage 3
+  s.rolling_avg5 = TWEEN256( s.rolling_avg5, s.rolling_avg4, p.alpha );               // Filter Stage 4
+  return s.rolling_avg5;
+}
+
+// PACKED REVERB NOTES:
+// • Everything that goes into the reverb is a 10-bit value, so with REVERB_PACKED the samples get stored 4 to every 5 bytes:
+//   the low 8 bits of each sample in the first 4 bytes of the group and the top 2 bits of all four in the 5th byte.
+//   That's 60% more delay time out of the same RAM, and it's lossless, so the reverb sounds exactly the same.
+// • A read is one byte load plus the 5th byte masked and multiplied up into place, and a write is one byte store plus a
+//   masked update of the 5th byte. The masks and multipliers come out of small tables (in the mapped flash), so the AVR
+//   never has to loop through a variable shift (it has a hardware multiply but no barrel shifter).
+// • The cost on the AVR hasn't been measured yet: there are no per-access cycle counts for either format. To get them,
+//   compare getFramePeriod() in audio mode with REVERB_PACKED on and off. etch-render runs the same code, but its
+//   throughput is a desktop figure and says nothing reliable about AVR cycles.
+
+const uint8_t  REVERB_LANE_MASK[4] PROGMEM_MAPPED = { 0x03, 0x0C, 0x30, 0xC0 };  // Where each sample's top 2 bits sit in the 5th byte
+const uint8_t  REVERB_LANE_UP[4]   PROGMEM_MAPPED = { 1, 4, 16, 64 };             // Moves the top 2 bits up into place (writing)
+const uint16_t REVERB_LANE_DOWN[4] PROGMEM_MAPPED = { 256, 64, 16, 4 };           // Moves them back up to bits 8 & 9 of the sample (reading)
+
+// Reads sample i out of the reverb buffer
+inline uint16_t kernelReverbRead( const KernelReverbCell *buf, uint16_t i ){
+#if REVERB_PACKED
+  const uint8_t *g = buf + (i >> 2) * 5;                        // Start of the 5 byte group
+  uint8_t lane = i & 3;
+  return g[lane] | uint16_t( g[4] & REVERB_LANE_MASK[lane] ) * REVERB_LANE_DOWN[lane];
+#else
+  return buf[i];
+#endif
+}
+
+// Writes a 10-bit sample into slot i of the reverb buffer
+inline void kernelReverbWrite( KernelReverbCell *buf, uint16_t i, uint16_t val ){
+#if REVERB_PACKED
+  uint8_t *g = buf + (i >> 2) * 5;                              // Start of the 5 byte group
+  uint8_t lane = i & 3;
+  g[lane] = uint8_t(val);                                       // Low 8 bits get a byte to themselves
+  g[4]    = ( g[4] & ~REVERB_LANE_MASK[lane] ) | uint8_t( uint8_t(val >> 8) * REVERB_LANE_UP[lane] );
+#else
+  buf[i] = val;
+#endif
+}
+
+// Fills the whole reverb buffer with silence (the middle value)
+inline void kernelReverbClear( const KernelParams &p ){
+  for( uint16_t i = 0; i < p.reverb_size; i++ ) kernelReverbWrite( p.reverb_buffer, i, 0x200 );
+}
+
+// REVERB NOTES:
+// • The reverb is a small Schroeder style network: REVERB_TAPS comb taps on one long delay line, followed by two allpass
+//   diffusers in series. They all share reverb_buffer. The delay line is everything except the last REVERB_ALLPASS_SIZE
+//   samples, which hold the two allpass rings.
+// • reverb_write_index is the write head on the delay line (e.g. "current time"). Each comb tap reads reverb_taps[k]
+//   samples behind it, so the taps never need heads of their own. The tap lengths are mutually prime, so the echoes
+//   smear into each other instead of lining up into a slapback.
+// • The average of the taps gets fed back into the line with the current sample. reverb_feedback (Reverb Feedbk) sets
+//   how much, exactly like the old single tap did. Reverb Delay stretches all of the taps together.
+// • The tap average then goes through the two allpass diffusers (gain 1/2), which thicken it up without coloring it, and
+//   gets mixed with the dry sample by reverb_wet_mix (Reverb Amount).
+// • Work per sample: REVERB_TAPS + 2 reads and 3 writes of reverb_buffer (the old single tap was 1 of each), plus a few
+//   adds and shifts. Everything is 16-bit, and the only multiplies are the two TWEEN256 mixes that were already there.
+//   That's an operation count, not a cycle count. The time it takes on the module hasn't been measured yet, so check it
+//   against the sample period with getFramePeriod() in audio mode before counting on the headroom.
+
+// GLIDING TAP NOTES:
+// • reverb_taps[] is only where the taps are headed. Each tap reads from its own fractional head (reverb_head[], with
+//   8 bits below the sample) that glides there, so turning Reverb Delay stretches the echoes that are already in the
+//   line like a tape delay's pitch bend instead of jumping the read point and clicking.
+// • Every sample the head covers 1/2^REVERB_GLIDE_SHIFT of the distance left (at least 1/256 of a sample, so it lands
+//   right on the tap), but never more than REVERB_GLIDE_MAX. That caps the bend when the knob gets spun all the way.
+// • A head between two samples reads both and blends them with TWEEN256 (linear interpolation). Once it lands the
+//   fraction is 0 and it goes back to a single read, so a settled reverb costs one 32-bit compare per tap over the
+//   plain version. While gliding it's one more read and one TWEEN256 per tap.
+
+// One Schroeder allpass (gain 1/2) on the len samples of buf starting at start. idx is its position in the ring
+inline uint16_t kernelAllpass( KernelReverbCell *buf, uint16_t start, uint16_t len, uint16_t &idx, uint16_t in ){
+  int16_t d = int16_t( kernelReverbRead( buf, start + idx ) ) - 0x200; // What went in len samples ago (centered on zero)
+  int16_t w = int16_t(in) - 0x200 + (d >> 1);                   // w = x + g*d goes back into the ring
+  int16_t y = d - (w >> 1);                                     // y = d - g*w comes out
+  kernelReverbWrite( buf, start + idx, constrain( int16_t(w + 0x200), int16_t(0), int16_t(0x3FF) ) );
+  if( ++idx >= len ) idx = 0;
+  return constrain( int16_t(y + 0x200), int16_t(0), int16_t(0x3FF) );
+}
+
+inline uint16_t kernelReverb( KernelState &s, const KernelParams &p, uint16_t output ){
+  uint16_t line = p.reverb_size - REVERB_ALLPASS_SIZE;          // Length of the main delay line
+
+  // COMB TAPS
+  uint16_t sum = 0;
+  for( uint8_t k = 0; k < REVERB_TAPS; k++ ){
+    uint32_t &h     = s.reverb_head[k];
+    uint32_t target = uint32_t(p.reverb_taps[k]) << 8;
+    if( h != target ){                                          // Glide the head toward its tap (See GLIDING TAP NOTES)
+      int32_t diff = int32_t(target - h);
+      int32_t step = constrain( diff >> REVERB_GLIDE_SHIFT, int32_t(-REVERB_GLIDE_MAX), int32_t(REVERB_GLIDE_MAX) );
+      if( step == 0 ) step = diff > 0 ? 1 : -1;                 // Creep the last little bit so it actually lands
+      h += step;
+    }
+    uint16_t i = s.reverb_write_index + line - uint16_t(h >> 8); // Whole samples behind the write head
+    if( i >= line ) i -= line;
+    uint16_t val  = kernelReverbRead( p.reverb_buffer, i );
+    uint8_t  frac = uint8_t(h);
+    if( frac ){                                                 // Between two samples, so blend in the next older one
+      uint16_t j = i ? i - 1 : line - 1;
+      val = TWEEN256( val, kernelReverbRead( p.reverb_buffer, j ), frac );
+    }
+    sum += val;
+  }
+  uint16_t tap = sum >> REVERB_TAP_SHIFT;                       // Average of the taps (still 10-bit)
+
+  // FEEDBACK
+  uint16_t val = constrain( uint16_t(tap << 1), uint16_t(0x200), uint16_t(0x5FF) ) - uint16_t(0x200);
+  kernelReverbWrite( p.reverb_buffer, s.reverb_write_index, TWEEN256(output, val, p.reverb_feedback) );
+  if( ++s.reverb_write_index >= line ) s.reverb_write_index = 0; // Move the write head along the delay line
+
+  // DIFFUSION
+  tap = kernelAllpass( p.reverb_buffer, line,              REVERB_AP1, s.reverb_ap_index[0], tap );
+  tap = kernelAllpass( p.reverb_buffer, line + REVERB_AP1, REVERB_AP2, s.reverb_ap_index[1], tap );
+
+  // WET / DRY MIX
+  val = constrain( uint16_t(tap + output), uint16_t(0x200), uint16_t(0x5FF)) - uint16_t(0x200);
+  return TWEEN256(output, val, p.reverb_wet_mix );
+}
+
+// Runs an already bit-crushed sample through the filter and the reverb (the whole audio mode chain)
+inline uint16_t kernelAudioSample( KernelState &s, const KernelParams &p, uint16_t crushed ){
+  return kernelReverb( s, p, kernelFilter( s, p, crushed ) );
+}
+
+// SOUND MORPHING NOTES:
+// • morph_rate is between 0 and 15 (4 bit number)
+// • morph_counter is determined by left shifting a 1 by morph_rate and then counting down from there to zero
+// • In order to convert morph_counter to a number consistently between 0 and 256 (to pull the correct TWEEN value)
+//   we neeed to shift the count to the appropriate bit depth for the morph_rate. If the rate is >= 8 then the morph_counter will be at least an
+//   8-bit values and we right shift by (morph_rate - 8) bits so it is exactly an 8-bit value. Otherwise we left shift by (8 - morph_rate) bits.
+// • The loop is split into MORPH_GRAINS grain slots. Each one crossfades from the morph_buffer (the last take) to the input_buffer
+//   (the newest one) over its own window of the morph, and the windows overlap by half, so the start of the loop gives way to the
+//   new take first and the rest follows it in turn instead of the whole loop fading at once.
+// • morph_counter only changes once per loop cycle, so the shift, the window math and the TWEEN_FN lookups all happen right there
+//   (kernelMorphGrains) instead of on every sample. On every sample the kernel only checks whether it crossed into the next grain and
+//   slews the weight toward that grain's (kernelMorphSlew), so the seams between grains fade over about 1 mS instead of clicking.
+// • The old per-sample path shifted a 32-bit morph_counter by a variable amount (a loop of 4 shifts per bit, up to 8 bits) and
+//   read TWEEN_FN out of flash. The new one is a grain check and the slew no matter what the rate is, and kernelMorphGrains
+//   only runs once per loop cycle. In AVR cycles these are estimates counted by hand, not measurements: about 30 to 60 for
+//   the old path, about 25 for the check and the slew, and about 150 for kernelMorphGrains. getFramePeriod() in loop mode
+//   is what will show whether the per-sample cost really went down. The sample kernels also don't need separate versions
+//   for the two shift directions any more, which frees up the flash they took.
+// • With MORPH_GRAINS at 1 the one window covers the whole morph, which is the plain two buffer crossfade.
+
+// Works out the weight of the morph_buffer (0...255) for every grain slot, for the loop cycle morph_counter is on
+inline void kernelMorphGrains( uint8_t *w, uint16_t morph_counter, uint8_t morph_rate ){
+  int16_t x = morph_rate >= 8 ? morph_counter >> (morph_rate - 8) : morph_counter << (8 - morph_rate); // 256 right after a take, down to 0
+  for( uint8_t g = 0; g < MORPH_GRAINS; g++ ){
+    int16_t start = (MORPH_GRAINS - 1 - g) * (256 / (MORPH_GRAINS + 1));    // Where this grain's window starts (the first grain goes first)
+    int16_t xg    = ( (x - start) * (MORPH_GRAINS + 1) ) >> 1;               // Stretch the window (2/(MORPH_GRAINS + 1) of the morph) out to 0...256
+    w[g] = TWEEN_FN[ constrain( xg, int16_t(0), int16_t(256) ) ];
+  }
+}
+
+// Moves the weight (0...255 with 7 extra bits of precision) part of the way toward the grain the loop is in
+inline uint8_t kernelMorphSlew( uint16_t &weight, uint8_t target ){
+  weight += int16_t( (uint16_t(target) << 7) - weight ) >> MORPH_SLEW;
+  return (weight + 64) >> 7;                                    // Rounded, since the shift above stalls just short of a target it's climbing to
+}
+
+// LOOP STORAGE NOTES:
+// • With LOOP_MULAW the audio loop & morph buffers store every sample as an 8-bit mu-law code (mu = 255) instead of a
+//   16-bit word, so the same RAM holds loops twice as long. The code is a sign bit (above or below the middle) and 7 bits
+//   of logarithmic distance from the middle, so quiet material keeps full 10-bit steps while the loudest parts get
+//   steps of about 22.
+// • Encoding and decoding are both a single lookup in a table the compiler builds (1 kB + 512 bytes of flash), so the
+//   ISR pays about one flash load more than reading a raw word. The morph copy moves the codes as they are, so a loop
+//   never gets re-encoded (and never loses any more) no matter how many morph cycles it goes through.
+// • 4-bit IMA-ADPCM would fit twice as many samples again, but each code only means something relative to the one before it.
+//   The loop gets read at fractional positions (with neighbours for the interpolation), copied into the morph buffer a
+//   sample at a time and recorded wherever the read pointer happens to be, so ADPCM would need a block decode on nearly
+//   every read. mu-law keeps every sample on its own.
+// • CV loops stay raw, since companding a pitch CV would detune it.
+// • etch-render --loop-codec mulaw plays the input through the same round trip and reports the error and the decode time.
+
+// KernelMuLawTable holds the mu-law codes for every 10-bit sample (enc) and the sample each code stands for (dec)
+struct KernelMuLawTable {
+  uint8_t  enc[1024];
+  uint16_t dec[256];
+  constexpr KernelMuLawTable() : enc(), dec() {
+    uint16_t mag[128] = {};                                     // Distance from the middle for each 7-bit code
+    for( uint8_t c = 1; c < 128; c++ ){
+      uint16_t m = uint16_t( 511.0 * ( kernelExp2( 8.0 * c / 127 ) - 1 ) / 255 + 0.5 ); // (256^(c/127) - 1) / 255 of full scale
+      mag[c] = m > mag[c-1] ? m : mag[c-1] + 1;                 // Every code at least one step past the last (the linear part near zero)
+    }
+    for( uint16_t c = 0; c < 128; c++ ){
+      dec[c]       = 0x200 + mag[c];                            // Codes 0...127 are at or above the middle
+      dec[c | 128] = 0x200 - mag[c] - 1;                        // and 128...255 below it
+    }
+    uint8_t c = 0;
+    for( uint16_t m = 0; m < 512; m++ ){                        // Walk up the distances, moving to the next code once it's closer
+      while( c < 127 && (mag[c+1] - m) < (m - mag[c]) + 1 ) c++;
+      enc[0x200 + m]     = c;
+      enc[0x200 - m - 1] = c | 128;
+    }
+  }
+};
+
+constexpr KernelMuLawTable MULAW PROGMEM_MAPPED;
+
+// Stores a 10-bit sample in the audio loop's format
+inline KernelLoopCell kernelLoopEncode( uint16_t val ){
+#if LOOP_MULAW
+  return MULAW.enc[val & 0x3FF];
+#else
+  return val;
+#endif
+}
+
+// Gets a 10-bit sample back out of the audio loop's format
+inline uint16_t kernelLoopDecode( KernelLoopCell cell ){
+#if LOOP_MULAW
+  return MULAW.dec[cell];
+#else
+  return cell;
+#endif
+}
+
+// LOOP RESAMPLER NOTES:
+// • The audio loop's read pointer is fractional: loop_pointer is the whole sample and loop_frac the 16-bit fraction past it.
+//   Every sample it moves loop_step along (16.16 fixed point, so 0x10000 plays the loop at the pitch it was recorded at).
+//   The timer never changes, so Loop Pitch transposes the loop by exact semitones (1v/oct) on top of the Rate knob.
+// • The morph blend gets worked out for each point the interpolation needs (the weight only once), and then LOOP_INTERP
+//   picks how the points get joined. Right on a sample (always the case at the recorded pitch) every order returns the
+//   plain morphed sample, so the loop sounds exactly like it did before until Loop Pitch moves.
+// • ESTIMATED cost on top of the drop-sample read, in AVR cycles. None of these have been measured: they come from adding
+//   up the operations by hand, guessing the 16x8 multiplies in TWEEN256 at about 20 cycles and the 32-bit ones at about
+//   40, with no compiler output to check against. Measure the real thing with getFramePeriod() in loop mode at a
+//   transposed pitch before picking an order on cost:
+//   - LOOP_INTERP_NONE:   0 (one morph, same as before)
+//   - LOOP_INTERP_LINEAR: about 60, estimated (a second morph + one TWEEN256 + the wrap check)
+//   - LOOP_INTERP_CUBIC:  about 250, estimated (four morphs + three 32-bit multiplies + the clamp)
+//   A tick at the top sample rate is 2000 cycles, so if the estimates hold, linear takes about 3% of it and cubic
+//   about 12%. Linear is the default.
+// • Recording follows the read pointer: when the morph cycle comes around, every whole sample the pointer passes gets the
+//   current input. Pitched up it skips along and pitched down it lingers, so the new take plays back at the original pitch.
+
+// KernelLoopPitchTable is loop_step for every Loop Pitch setting (0...2*LOOP_PITCH_RANGE semitones, the middle one
+// plays the loop at its own pitch). It is built by the compiler
+struct KernelLoopPitchTable {
+  uint32_t step[LOOP_PITCH_RANGE * 2 + 1];
+  constexpr KernelLoopPitchTable() : step() {
+    for( uint8_t i = 0; i <= LOOP_PITCH_RANGE * 2; i++ )
+      step[i] = uint32_t( 65536.0 / kernelExp2( LOOP_PITCH_RANGE / 12.0 ) * kernelExp2( i / 12.0 ) + 0.5 );
+  }
+};
+
+// One morphed loop sample (w is the morph weight from kernelMorphSlew)
+inline uint16_t kernelLoopPoint( const KernelLoopCell *input, const KernelLoopCell *morph, uint16_t i, uint8_t w ){
+  return TWEEN256( kernelLoopDecode( input[i] ), kernelLoopDecode( morph[i] ), w );
+}
+
+// Reads the morphed loop at the fractional position i + frac/65536, interpolated by LOOP_INTERP. len is the loop length
+// and w the morph weight
+inline uint16_t kernelLoopRead( const KernelLoopCell *input, const KernelLoopCell *morph, uint16_t i, uint16_t frac, uint16_t len, uint8_t w ){
+  uint16_t y1 = kernelLoopPoint( input, morph, i, w );
+#if LOOP_INTERP == LOOP_INTERP_NONE
+  return y1;
+#else
+  uint8_t t = frac >> 8;                                        // 8 bits of fraction is plenty for 10-bit samples
+  if( t == 0 ) return y1;                                       // Right on a sample
+  uint16_t j  = (i + 1 < len) ? i + 1 : 0;                      // The next sample wraps around to the start of the loop
+  uint16_t y2 = kernelLoopPoint( input, morph, j, w );
+#if LOOP_INTERP == LOOP_INTERP_LINEAR
+  return TWEEN256( y1, y2, t );
+#else
+  uint16_t h  = i ? i - 1 : len - 1;                            // and so do the outer two points
+  uint16_t k  = (j + 1 < len) ? j + 1 : 0;
+  int16_t  y0 = kernelLoopPoint( input, morph, h, w );
+  int16_t  y3 = kernelLoopPoint( input, morph, k, w );
+  int32_t  c1 = int16_t(y2) - y0;                               // Catmull-Rom with everything doubled so there are no halves:
+  int32_t  c2 = 2*y0 - 5*int16_t(y1) + 4*int16_t(y2) - y3;      // 2p(t) = 2y1 + t(c1 + t(c2 + t c3))
+  int32_t  c3 = 3*(int16_t(y1) - int16_t(y2)) + y3 - y0;
+  int32_t  v  = ( ( ( ( ( (c3 * t) >> 8 ) + c2 ) * t >> 8 ) + c1 ) * t ) >> 9;
+  return constrain( int16_t(y1 + v), int16_t(0), int16_t(0x3FF) );
+#endif
+#endif
+}
+
+// Runs a raw CV reading through glide and scale crush and returns the note in the scale (0...120), before transposition
+inline uint8_t kernelCVScaleNote( KernelState &s, const KernelParams &p, uint16_t val ){
+  // ------ TRANSFORMATION: Glide ------ //
+  int16_t diff = int16_t( (val << 5) - s.glide_avg );                 // How far the input is from the glide average (both with 5 extra bits)
+  s.glide_avg += int16_t( (int32_t(diff) * p.glide) >> 16 );           // Move the average part of the way there (See kernelGlideCoef)
+  val = (s.glide_avg + 16) >> 5;                                       // Set val to the filtered value (rounded back to 10 bits)
+
+  // ------ TRANSFORMATION: Scale Crush ------ //
+  uint8_t note = ((uint32_t(val) * 120) >> 10 );                       // Quantize the note to a chromatic scale, assuming 1v/oct
+  uint8_t note_scale = note % 12;                                      // Identify the note within the 12 note chromatic scale
+  uint8_t note_oct   = note / 12;                                      // Figure out the octave of the note
+
+  uint16_t mask  = p.scale.always;                                     // Start with the notes that are always in the scale
+  uint16_t maybe = p.scale.maybe;                                      // and roll the dice for each of the weighted notes
+  for( uint8_t i = 0; maybe; i++, maybe >>= 1 ){
+    if( (maybe & 1) && kernelRandom(s) >= p.scale.cut[i] ) mask |= uint16_t(1) << i;
+  }
+  s.scale_mask = mask;                                                 // Hang on to it for the keyboard display
+
+  if( mask ){                                                          // Take the current note and snap it to the scale (See QUANT_STEPS)
+    uint16_t rot   = ( (mask >> note_scale) | (mask << (12 - note_scale)) ) & 0xFFF; // Rotate the mask so the current note is bit 0
+    uint8_t  steps = QUANT_STEPS.steps[rot];
+    uint8_t  up    = steps >> 4;                                       // Semitones up to the next note in the scale
+    uint8_t  down  = steps & 0x0F;                                     // Semitones down to the next note in the scale
+    bool go_up = (p.quant_mode == QUANT_UP) || ((p.quant_mode == QUANT_NEAREST) && (up < down));
+    if( down > note ) go_up = true;                                    // Can't go below the lowest note
+    if( note + up > 120 ) go_up = false;                               // or above the highest one (119 + up would run to 130)
+    note = go_up ? note + up : note - down;
+  } else {
+    note = note_oct * 12;                                              // No notes in the scale at all, so fall back to the root
+  }
+  return note;
+}
+
+// Transposes a note in the scale by the root setting
+inline uint8_t kernelCVTranspose( const KernelParams &p, uint8_t note ){
+  uint16_t out = uint16_t(note) + p.note_offset;                      // Add the transposition (16 bits so a big offset can't wrap)
+  if( out > 120 ) out = 120;                                           // Constrain the note to be less than 120 notes (10v output 12 notes per octave)
+  return out;
+}
+
+// Runs a raw CV reading through glide, scale crush and transposition and returns the output note (0...120). Look the note
+// up in NOTE_LEVEL for the 0...1023 level and in p.note_dac for the calibrated DAC value
+inline uint8_t kernelCVNote( KernelState &s, const KernelParams &p, uint16_t val ){
+  return kernelCVTranspose( p, kernelCVScaleNote( s, p, val ) );
+}
+
+// CV LOOP NOTES:
+// • CV loops store the note each step landed on, not the raw CV reading, so playing a loop back is a table read instead
+//   of running glide and the scale crush over again on every step. Each step is one byte (a KernelCVCell), so the arena
+//   CV mode gets (See ARENA_LAYOUT in dsp.h) holds twice as many steps as it did with 16-bit readings.
+// • The cell is the note in the scale before transposition (7 bits, 0...120) plus KERNEL_CV_TIE. Transposition still
+//   gets added on the way out, so the Quant Root setting moves a loop that is already playing. The scale and glide are
+//   baked in when a step gets recorded, so changing them only shows up as the morph records over the old steps.
+// • KERNEL_CV_TIE marks a step that held the note of the step before it (the clock stepped but the note didn't change).
+//   Steps from a trigger are always new notes. The DAC doesn't care either way, so playback masks it off. It is there for
+//   anything that wants to tell a held note from a struck one (like a gate output).
+// • The morph can't blend two notes without landing between the scale's notes, so it picks one or the other for every
+//   step instead. Each step switches over at its own point in the morph (kernelCVLoopCell), which spreads the change out
+//   over the morph the way the blend does for audio.
+
+typedef uint8_t KernelCVCell;
+
+#define KERNEL_CV_NOTE 0x7F                                     // Note in the scale before transposition (0...120)
+#define KERNEL_CV_TIE  0x80                                     // The note was held over from the step before
+
+// Packs the note a step landed on into a CV loop cell. prev is the cell recorded on the step before it
+template<bool TRIGGER>
+inline KernelCVCell kernelCVCell( uint8_t note, KernelCVCell prev ){
+  if( !TRIGGER && note == (prev & KERNEL_CV_NOTE) ) return note | KERNEL_CV_TIE;
+  return note;
+}
+
+// Picks step i out of the recorded loop or the morph buffer (w is the weight of its grain, See kernelMorphGrains). Every step
+// gets its own threshold (i * 157 walks through all 256 of them before repeating), so the steps switch over one by one
+inline KernelCVCell kernelCVLoopCell( const KernelCVCell *input, const KernelCVCell *morph, uint16_t i, uint8_t w ){
+  return w > uint8_t(i * 157) ? morph[i] : input[i];
+}
+
+#endif
@@ -58,6 +58,7 @@ This library implements a set of menu functions for the Etch Module.
 // Additional Menu Options:
 // • Quant Root    - Root note of the quantized scale
 // • Quant Scale   - Selects the scale
+// • Quant Mode    - Snaps notes to the nearest note in the scale, or always up or always down
 // • Morph Rate    - In Loop Mode this determines the percentage of time that new samples are added to loop
 // • Loop Length   - Determines the number of notes in the loop
 // • Arpeggiation  - Style of Arpeggiation (0 - none... ?)
@@ -69,6 +70,9 @@ This library implements a set of menu functions for the Etch Module.
 #define OPT_INT   0  // Normal integer type, appears with a bar
 #define OPT_SCALE 1  // Text option for different scales "Major", "Minor", etc.
 #define OPT_NOTE  2  // C, C#, D, D#, E, F, F#, G, G#, A, A#, B
+#define OPT_QUANT 3  // Text option for the quantize modes "Nearest", "Up", "Down"
+#define OPT_SEMI  4  // Semitones around the middle of the range: -24 ... +24 (LOOP_PITCH_RANGE in kernel.h)
+#define OPT_LONG  5  // Integer with up to 4 digits, appears with a bar scaled to the setting's max (loop lengths)
 
 #define OPT_LOOP_NO     0
 #define OPT_LOOP_YES    1
@@ -81,12 +85,13 @@ const char MENU_CALLIBRATION_MODE[] PROGMEM = "Callibration Mode  ";
 
 #define NUM_MENU_MODES 4
 uint8_t menu_counts[NUM_MENU_MODES] = {0};
-const char* MAIN_MENU[] = { MENU_AUDIO_MODE, MENU_QUANTIZER_MODE, MENU_CALLIBRATION_MODE };
+const char* const MAIN_MENU[] PROGMEM_MAPPED = { MENU_AUDIO_MODE, MENU_QUANTIZER_MODE, MENU_CALLIBRATION_MODE };
 
 
 
 // Audio Menu Label Strings
 const char MENU_LOOP_LENGTH[] PROGMEM = "Loop Length  ";
+const char MENU_LOOP_PITCH[]  PROGMEM = "Loop Pitch   ";
 const char MENU_RESONANCE[]   PROGMEM = "Resonance    ";
 const char MENU_REVERB_AMT[]  PROGMEM = "Reverb Amount";
 const char MENU_REVERB_DLY[]  PROGMEM = "Reverb Delay ";
@@ -96,6 +101,7 @@ const char MENU_MORPH_RATE[]  PROGMEM = "Morph Rate   ";
 // CV Menu Label Strings
 const char MENU_QUANT_ROOT[]  PROGMEM = "Quant Root   ";
 const char MENU_QUANT_SCALE[] PROGMEM = "Quant Scale  "; // 0 - Major, 1 - Minor
+const char MENU_QUANT_MODE[]  PROGMEM = "Quant Mode   "; // 0 - Nearest, 1 - Up, 2 - Down
 
 // Menu Option Strings
 const char OPTION_SCALE_MAJOR[] PROGMEM = "Major";
@@ -106,8 +112,8 @@ const char OPTION_SCALE_MINOR[] PROGMEM = "Minor";
 struct MenuSetting {
   uint8_t     mode;
   const char* label;
-  uint8_t     value;
-  uint8_t     max;
+  uint16_t    value;
+  uint16_t    max;
   uint8_t     inc;
   uint8_t     type;
   uint8_t     loopMode;
@@ -116,33 +122,37 @@ struct MenuSetting {
 // Setting Identifiers:
 #define MS_AUD_LOOP_LENGTH  0
 #define MS_AUD_MORPH_RATE   1
-#define MS_AUD_RESONANCE    2
-#define MS_AUD_REVERB_AMT   3
-#define MS_AUD_REVERB_DLY   4
-#define MS_AUD_REVERB_FBK   5
-#define MS_CV_QUANT_ROOT    6
-#define MS_CV_QUANT_SCALE   7
-#define MS_CV_LOOP_LENGTH   8
-#define MS_CV_MORPH_RATE    9
-
-
-#define NUM_MENU_SETTINGS 10
+#define MS_AUD_LOOP_PITCH   2
+#define MS_AUD_RESONANCE    3
+#define MS_AUD_REVERB_AMT   4
+#define MS_AUD_REVERB_DLY   5
+#define MS_AUD_REVERB_FBK   6
+#define MS_CV_QUANT_ROOT    7
+#define MS_CV_QUANT_SCALE   8
+#define MS_CV_QUANT_MODE    9
+#define MS_CV_LOOP_LENGTH   10
+#define MS_CV_MORPH_RATE    11
+
+
+#define NUM_MENU_SETTINGS 12
 MenuSetting MenuSettings[ NUM_MENU_SETTINGS ]{
 
-//  Mode  Label String      Val   Max   Increment  Type       Loop Mode Required?
-  { 1,    MENU_LOOP_LENGTH, 0x10, 0xFF, 0x04,      OPT_INT,   OPT_LOOP_YES    },
-  { 1,    MENU_MORPH_RATE,  0x01, 0x0F, 0x01,      OPT_INT,   OPT_LOOP_YES    },
-  { 1,    MENU_RESONANCE,   0x00, 0xFF, 0x04,      OPT_INT,   OPT_LOOP_EITHER },
+//  Mode  Label String      Val   Max              Increment  Type       Loop Mode Required?
+  { 1,    MENU_LOOP_LENGTH, 0x10, AUDIO_LOOP_SIZE, 0x04,      OPT_LONG,  OPT_LOOP_YES    },
+  { 1,    MENU_MORPH_RATE,  0x01, 0x0F,            0x01,      OPT_INT,   OPT_LOOP_YES    },
+  { 1,    MENU_LOOP_PITCH,  0x18, 0x30,            0x01,      OPT_SEMI,  OPT_LOOP_YES    },
+  { 1,    MENU_RESONANCE,   0x00, 0xFF,            0x04,      OPT_INT,   OPT_LOOP_EITHER },
 
-  { 1,    MENU_REVERB_AMT,  0x00, 0xFF, 0x04,      OPT_INT,   OPT_LOOP_EITHER },
-  { 1,    MENU_REVERB_DLY,  0x80, 0xFF, 0x04,      OPT_INT,   OPT_LOOP_EITHER },
-  { 1,    MENU_REVERB_FBK,  0x80, 0xFF, 0x02,      OPT_INT,   OPT_LOOP_EITHER },
+  { 1,    MENU_REVERB_AMT,  0x00, 0xFF,            0x04,      OPT_INT,   OPT_LOOP_EITHER },
+  { 1,    MENU_REVERB_DLY,  0x80, 0xFF,            0x04,      OPT_INT,   OPT_LOOP_EITHER },
+  { 1,    MENU_REVERB_FBK,  0x80, 0xFF,            0x02,      OPT_INT,   OPT_LOOP_EITHER },
 
 
-  { 2,    MENU_QUANT_ROOT,  0x00, 0x0C, 0x01,      OPT_NOTE,  OPT_LOOP_EITHER },
-  { 2,    MENU_QUANT_SCALE, 0x00, 0x15, 0x01,      OPT_SCALE, OPT_LOOP_EITHER },
-  { 2,    MENU_LOOP_LENGTH, 0x10, 0xFF, 0x01,      OPT_INT,   OPT_LOOP_YES },
-  { 2,    MENU_MORPH_RATE,  0x00, 0xFF, 0x01,      OPT_INT,   OPT_LOOP_YES }
+  { 2,    MENU_QUANT_ROOT,  0x00, 0x0C,            0x01,      OPT_NOTE,  OPT_LOOP_EITHER },
+  { 2,    MENU_QUANT_SCALE, 0x00, 0x15,            0x01,      OPT_SCALE, OPT_LOOP_EITHER },
+  { 2,    MENU_QUANT_MODE,  0x00, 0x02,            0x01,      OPT_QUANT, OPT_LOOP_EITHER },
+  { 2,    MENU_LOOP_LENGTH, 0x10, CV_LOOP_STEPS,   0x10,      OPT_LONG,  OPT_LOOP_YES    },
+  { 2,    MENU_MORPH_RATE,  0x00, 0xFF,            0x01,      OPT_INT,   OPT_LOOP_YES    }
 
 };
 
@@ -150,7 +160,7 @@ MenuSetting MenuSettings[ NUM_MENU_SETTINGS ]{
 
 
 // Default Menu Template Character Map
-uint8_t menuTemplate[84] = {
+const uint8_t menuTemplate[84] PROGMEM_MAPPED = {
   0xC4, 0xC4, 0xC2, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC4, 0xC2, 0xC4, 0xC4,
   0x20, 0x20, 0xB3, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0xB3, 0x20, 0x20,
   0xAE, 0x20, 0xB3, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0xB3, 0x20, 0xAF,
@@ -158,11 +168,11 @@ uint8_t menuTemplate[84] = {
 };
 
 // Define a gradient of characters for progress bars
-uint8_t gradChars[5] = { 0x20, 0xB0, 0xB1, 0xB2, 0xDB }; // characters that progressively go from blank to all white
+const uint8_t gradChars[5] PROGMEM_MAPPED = { 0x20, 0xB0, 0xB1, 0xB2, 0xDB }; // characters that progressively go from blank to all white
 
 // Note Scale
-const char notes[12]  = {'C','C','D','D','E','F','F','G','G','A','A','B'};
-const char sharps[12] = {' ','#',' ','#',' ',' ','#',' ','#',' ','#',' '};
+const char notes[12]  PROGMEM_MAPPED = {'C','C','D','D','E','F','F','G','G','A','A','B'};
+const char sharps[12] PROGMEM_MAPPED = {' ','#',' ','#',' ',' ','#',' ','#',' ','#',' '};
 
 // Scale Names
 const char SCALE_00[] PROGMEM = "Chromatic    ";
@@ -190,11 +200,18 @@ const char SCALE_21[] PROGMEM = "Romanian     ";
 
 
 
-const char* const scaleNames[] = { SCALE_00, SCALE_01, SCALE_02, SCALE_03, SCALE_04,
-                                   SCALE_05, SCALE_06, SCALE_07, SCALE_08, SCALE_09, 
-                                   SCALE_10, SCALE_11, SCALE_12, SCALE_13, SCALE_14,
-                                   SCALE_15, SCALE_16, SCALE_17, SCALE_18, SCALE_19,
-                                   SCALE_20, SCALE_21 };
+const char* const scaleNames[] PROGMEM_MAPPED = { SCALE_00, SCALE_01, SCALE_02, SCALE_03, SCALE_04,
+                                                  SCALE_05, SCALE_06, SCALE_07, SCALE_08, SCALE_09, 
+                                                  SCALE_10, SCALE_11, SCALE_12, SCALE_13, SCALE_14,
+                                                  SCALE_15, SCALE_16, SCALE_17, SCALE_18, SCALE_19,
+                                                  SCALE_20, SCALE_21 };
+
+// Quantize Mode Names (same order as QUANT_NEAREST, QUANT_UP, QUANT_DOWN in kernel.h)
+const char QUANT_00[] PROGMEM = "Nearest";
+const char QUANT_01[] PROGMEM = "Up     ";
+const char QUANT_02[] PROGMEM = "Down   ";
+
+const char* const quantNames[] PROGMEM_MAPPED = { QUANT_00, QUANT_01, QUANT_02 };
 
 
 class Menu {
@@ -218,7 +235,7 @@ class Menu {
     // Menu Generation functions:
     void swapCharPage( uint8_t direction );           // Animate in the hidden page. 0 - right to left, 1 - left to right
     void generateBottomMenu( MenuSetting &setting, bool isVisible );
-    void generateBottomMenu( char *label, uint16_t val, uint8_t type, bool isVisible ); // Create populated menu template in the buffer
+    void generateBottomMenu( char *label, uint16_t val, uint16_t max, uint8_t type, bool isVisible ); // Create populated menu template in the buffer
     void drawBottomMenu();
 
     void generateModeMenu( bool isVisible );
@@ -254,8 +271,9 @@ class Menu {
     void updateMenu();
 
     // Menu Setting Fetch Options:
-    uint8_t getAudLoopLength(){ return( hw->loop ? MenuSettings[MS_AUD_LOOP_LENGTH].value : 0 ); }
+    uint16_t getAudLoopLength(){ return( hw->loop ? MenuSettings[MS_AUD_LOOP_LENGTH].value : 0 ); }
     uint8_t getAudMorphRate(){  return( MenuSettings[ MS_AUD_MORPH_RATE ].value ); }
+    uint8_t getAudLoopPitch(){  return( MenuSettings[ MS_AUD_LOOP_PITCH ].value ); }
     uint8_t getAudResonance(){  return( MenuSettings[ MS_AUD_RESONANCE  ].value ); }
 
     uint8_t getReverbAmount(){   return( MenuSettings[ MS_AUD_REVERB_AMT ].value ); }
@@ -264,7 +282,8 @@ class Menu {
 
     uint8_t getRoot(){         return( MenuSettings[ MS_CV_QUANT_ROOT  ].value ); }
     uint8_t getScale(){        return( MenuSettings[ MS_CV_QUANT_SCALE ].value ); }
-    uint8_t getCVLoopLength(){ return( hw->loop ? MenuSettings[ MS_CV_LOOP_LENGTH ].value : 0 ); }
+    uint8_t getQuantMode(){    return( MenuSettings[ MS_CV_QUANT_MODE  ].value ); }
+    uint16_t getCVLoopLength(){ return( hw->loop ? MenuSettings[ MS_CV_LOOP_LENGTH ].value : 0 ); }
     uint8_t getCVMorphRate(){  return( MenuSettings[ MS_CV_MORPH_RATE  ].value ); }
 
 };
@@ -330,14 +349,14 @@ void Menu::drawModeMenu(){
 void Menu::generateBottomMenu( MenuSetting &setting, bool isVisible ){
   char label[14];
   strcpy_P( label, setting.label );
-  generateBottomMenu( label, setting.value, setting.type, isVisible );  
+  generateBottomMenu( label, setting.value, setting.max, setting.type, isVisible );  
 }
 
 
-void Menu::generateBottomMenu( char *label, uint16_t val, uint8_t type, bool isVisible ){
+void Menu::generateBottomMenu( char *label, uint16_t val, uint16_t max, uint8_t type, bool isVisible ){
   uint8_t page = isVisible ? char_buffer_page : (char_buffer_page + 1) % 2;
   uint8_t *dPtr = &display_char_buffer[SCREEN_BUFFER_COLS*4 + page * SCREEN_VISIBLE_COLS];
-  uint8_t *sPtr = &menuTemplate[0];
+  const uint8_t *sPtr = &menuTemplate[0];
 
   setting_type = type;
 
@@ -362,6 +381,15 @@ void Menu::generateBottomMenu( char *label, uint16_t val, uint8_t type, bool isV
       dPtr += val/25;                            // Move pointer over by the number of cells that we filled
       memset( dPtr, gradChars[ (val/5)%5 ], 1);  // Set the final cell to the correct amonunt of fill
       break;
+    case OPT_LONG: {
+      sprintf( (char *)dPtr, "%4u", val );       // Print the value (one column wider than OPT_INT)
+      dPtr += 4;                                 // Increment 4 columns to the right to draw the bar visualization
+      uint8_t bar = uint32_t(val) * 49 / max;    // Scale the bar so the max just fits in the 10 cells left (49 fifths)
+      memset( dPtr, gradChars[4], bar/5 );       // Set the cells of the bar that are full to pure white
+      dPtr += bar/5;                             // Move pointer over by the number of cells that we filled
+      memset( dPtr, gradChars[ bar%5 ], 1);      // Set the final cell to the correct amonunt of fill
+      break;
+    }
     case OPT_NOTE:
       memset( dPtr++, notes[val % 12],  1 );     // Print the note letter
       memset( dPtr++, sharps[val % 12], 1 );     // Print whether the note is sharp or not
@@ -374,6 +402,15 @@ void Menu::generateBottomMenu( char *label, uint16_t val, uint8_t type, bool isV
       dPtr += SCREEN_BUFFER_COLS;                // Go to the next row 
       memcpy_P( dPtr, scaleNames[val], 13 );     // Write the scale name
       break;
+    case OPT_QUANT:
+      memcpy_P( dPtr, quantNames[val], 7 );      // Write the quantize mode name
+      break;
+    case OPT_SEMI: {
+      char semi[8];
+      sprintf( semi, "%+3d st", int(val) - LOOP_PITCH_RANGE ); // Print the transposition (the middle of the range is 0)
+      memcpy( dPtr, semi, 6 );                   // without the terminator landing on the template
+      break;
+    }
     default:
       break;
   }
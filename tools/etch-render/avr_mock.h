@@ -0,0 +1,145 @@
+#ifndef AVR_MOCK_H
+#define AVR_MOCK_H
+
+/*
+ETCH Firmware source code designed to run on the AVR128DA28.
+Copyright (C) 2024 Tyler Klein (Things Made Simple)
+Etch Hardware Design by Juanito Moore (Modular for the Masses)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+--- Description: ---
+Desktop stand-ins for the ADC0, DAC0 and TCA0 registers, so the register-level
+code the ISR uses (adc.h) can run off the module. Include this before adc.h.
+
+The mock ADC behaves like the real one as far as the pipeline cares:
+  • Writing ADC_STCONV_bm to COMMAND samples input[MUXPOS]. With
+    conversion_ticks at 0 (the default) the result and RESRDY are there right
+    away. Otherwise COMMAND reads back STCONV until mockTick() has been called
+    conversion_ticks times, and then RESRDY goes up.
+  • Reading RES hands back the result and clears RESRDY.
+  • Anything can change MUXPOS in between (like the control scans do).
+  • Starting a conversion while one is still running counts as a collision.
+Set input[] to the voltage on each pin (in 10-bit ADC counts) before each tick.
+
+TCA0 only moves when mockTick() is called. Each call is one timer count: CNT
+goes up and wraps to 0 after PER, which is the overflow that runs the ISR.
+
+There is no interrupt controller, so call adcResultReady() yourself whenever
+RESRDY is set (that's what the ADC0 RESRDY interrupt does on the module).
+*/
+
+#include <stdint.h>
+
+
+/*******************************************
+* Register Bit Definitions                 *
+*******************************************/
+
+#define ADC_STCONV_bm       0x01                                // Same values as the AVR128DA28 headers
+#define ADC_RESRDY_bm       0x01
+#define ADC_MUXPOS_AIN0_gc  0x00
+#define ADC_MUXPOS_AIN1_gc  0x01
+#define ADC_MUXPOS_AIN2_gc  0x02
+#define ADC_MUXPOS_AIN3_gc  0x03
+
+#define MOCK_ADC_CHANNELS   32                                  // MUXPOS is 5 bits wide on the AVR128DA28
+
+
+/*******************************************
+* ADC0 / DAC0 / TCA0 Mocks                 *
+*******************************************/
+
+struct MockADC {
+  struct Command {                                              // Writing STCONV samples the input and starts the conversion
+    MockADC *adc;
+    uint8_t  value;
+    Command &operator=( uint8_t v ){
+      if( v & ADC_STCONV_bm ){
+        if( adc->remaining ) adc->collisions++;                 // The real ADC would throw away the one that was running
+        adc->sampled = adc->input[adc->MUXPOS % MOCK_ADC_CHANNELS];
+        adc->conversions++;
+        adc->remaining = adc->conversion_ticks;
+        value = ADC_STCONV_bm;                                  // STCONV reads back as set while the conversion runs
+        if( !adc->remaining ) adc->finish();
+      }
+      return *this;
+    }
+    operator uint8_t() const { return value; }
+  };
+  struct Result {                                               // Reading RES clears RESRDY, just like the real thing
+    MockADC *adc;
+    operator uint16_t() const {
+      adc->INTFLAGS &= ~ADC_RESRDY_bm;
+      return adc->result;
+    }
+  };
+
+  uint8_t  MUXPOS   = 0;
+  uint8_t  INTCTRL  = 0;
+  uint8_t  INTFLAGS = 0;
+  Command  COMMAND  = { this, 0 };
+  Result   RES      = { this };
+
+  uint16_t input[MOCK_ADC_CHANNELS] = {0};                      // Voltage on each pin in ADC counts (set by the caller)
+  uint16_t conversion_ticks = 0;                                // TCA0 counts a conversion takes (0 finishes it on the spot)
+  uint16_t remaining   = 0;                                     // Counts left on the conversion that's running (0 when idle)
+  uint16_t sampled     = 0;                                     // Input sampled when the running conversion started
+  uint16_t result      = 0;                                     // Latched conversion result
+  uint32_t conversions = 0;                                     // Number of conversions started (handy for checking the pipeline)
+  uint32_t collisions  = 0;                                     // Conversions started on top of one that was still running
+
+  MockADC(){}
+  MockADC( const MockADC & ) = delete;                          // COMMAND and RES point back at this instance, so no copies
+
+  void finish(){                                                // The conversion is done: latch it and raise RESRDY
+    result        = sampled;
+    INTFLAGS     |= ADC_RESRDY_bm;
+    COMMAND.value = 0;
+  }
+};
+
+struct MockDAC {
+  uint16_t DATA = 0;                                            // Left-adjusted 10-bit value, the same as DAC0.DATA
+};
+
+struct MockTCA {
+  struct {
+    uint16_t PER = 0xFFFF;                                      // Unless mockTick() moves the timer, there is always
+    uint16_t CNT = 0;                                           // time left to scan before the next tick
+  } SINGLE;
+};
+
+static MockADC ADC0;
+static MockDAC DAC0;
+static MockTCA TCA0;
+
+// Moves the mock on by one TCA0 count: a running conversion gets one count closer to done, and CNT goes up (wrapping
+// to 0 after PER). Returns true when the timer overflows, which is when the module would run the ISR
+inline bool mockTick(){
+  if( ADC0.remaining && !--ADC0.remaining ) ADC0.finish();
+  if( TCA0.SINGLE.CNT >= TCA0.SINGLE.PER ){
+    TCA0.SINGLE.CNT = 0;
+    return true;
+  }
+  TCA0.SINGLE.CNT++;
+  return false;
+}
+
+inline void noInterrupts(){}                                    // Nothing interrupts anything on the desktop
+inline void interrupts(){}
+
+#define PROGMEM_MAPPED                                          // DxCore's mapped flash section. On the desktop it's all just memory
+
+#endif
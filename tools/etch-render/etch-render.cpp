@@ -0,0 +1,381 @@
+/*
+ETCH Firmware source code designed to run on the AVR128DA28.
+Copyright (C) 2024 Tyler Klein (Things Made Simple)
+Etch Hardware Design by Juanito Moore (Modular for the Masses)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+--- Description: ---
+etch-render streams a WAV file through the same fixed-point kernel that runs
+inside the ISR (kernel.h) so changes to the audio path can be heard and timed
+on a desktop computer before flashing a module.
+
+Build (from the root of the repository):
+  g++ -O2 -std=c++14 -o etch-render tools/etch-render/etch-render.cpp
+
+Usage:
+  etch-render [options] input.wav output.wav
+
+The knob options take the same 0...1023 values the module reads from its pots
+and the menu options take the same 0...255 values as the menu settings. The
+ISR ticks at the module's fixed rate and --rate drives the same phase
+accumulator as DSP::setSampleRateExp, so the input is sampled-and-held at the
+module's sample rate and the output is held between samples just like the DAC.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <math.h>
+#include <vector>
+
+#include "avr_mock.h"
+#include "../../kernel.h"
+#include "../../adc.h"
+
+
+/*******************************************
+* Render Settings                          *
+*******************************************/
+
+#define RENDER_MODE_AUDIO 1                                     // Same numbers as MODE_AUDIO / MODE_CV in dsp.h
+#define RENDER_MODE_CV    2
+
+#define REVERB_WORDS       3072                                 // Matches REVERB_WORDS & REVERB_BUFFER_SIZE in dsp.h
+#if REVERB_PACKED
+#define REVERB_BUFFER_SIZE ((REVERB_WORDS * 2 / 5) * 4)
+#else
+#define REVERB_BUFFER_SIZE REVERB_WORDS
+#endif
+#define CV_CLOCK_DIVIDER   128                                  // Matches CV_CLOCK_DIVIDER in dsp.h
+#define ISR_TICK_PERIOD    2000                                 // Matches ISR_TICK_PERIOD in dsp.h (without the block engine)
+
+constexpr KernelPhaseTable PHASE_INC( ISR_TICK_PERIOD );
+
+struct RenderSettings {
+  uint8_t  mode            = RENDER_MODE_AUDIO;
+  uint16_t rate            = 1023;                              // Rate knob       0...1023
+  uint16_t crush           = 0;                                 // Crush knob      0...1023 (fully counter-clockwise: no crush)
+  uint16_t filter          = 1023;                              // Filter knob     0...1023 (fully clockwise: filter open)
+  uint8_t  resonance       = 0x00;                              // Menu settings   0...255  (same defaults as MenuSettings in menu.h)
+  uint8_t  reverb_amount   = 0x00;
+  uint8_t  reverb_delay    = 0x80;
+  uint8_t  reverb_feedback = 0x80;
+  uint8_t  root            = 0x00;
+  uint8_t  scale           = 0x00;
+  uint8_t  quant_mode      = QUANT_NEAREST;
+  uint16_t seed            = 0xACE1;                            // Same starting xorshift state as kernelReset
+  bool     loop_mulaw      = false;                             // Play the crushed input through the audio loop's mu-law round trip
+};
+
+
+/*******************************************
+* WAV File Handling                        *
+*******************************************/
+
+struct Wav {
+  uint32_t sample_rate = 0;
+  uint16_t channels    = 0;
+  std::vector<int16_t> samples;                                 // First channel only
+};
+
+static uint32_t readLE( const uint8_t *p, uint8_t bytes ){
+  uint32_t v = 0;
+  for( uint8_t i = 0; i<bytes; i++ ) v |= uint32_t(p[i]) << (8*i);
+  return v;
+}
+
+static void writeLE( FILE *f, uint32_t v, uint8_t bytes ){
+  for( uint8_t i = 0; i<bytes; i++ ) fputc( (v >> (8*i)) & 0xFF, f );
+}
+
+// Reads a 16-bit PCM WAV file. Returns false (and prints why) if the file can't be used
+static bool readWav( const char *path, Wav &wav ){
+  FILE *f = fopen( path, "rb" );
+  if( !f ){ fprintf( stderr, "etch-render: can't open %s\n", path ); return false; }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while( (n = fread( chunk, 1, sizeof(chunk), f )) > 0 ) data.insert( data.end(), chunk, chunk + n );
+  fclose( f );
+
+  if( data.size() < 12 || memcmp( &data[0], "RIFF", 4 ) || memcmp( &data[8], "WAVE", 4 ) ){
+    fprintf( stderr, "etch-render: %s is not a WAV file\n", path );
+    return false;
+  }
+
+  uint16_t format = 0, bits = 0;
+  size_t pos = 12;
+  while( pos + 8 <= data.size() ){
+    uint32_t size = readLE( &data[pos+4], 4 );
+    const uint8_t *body = &data[pos+8];
+    if( pos + 8 + size > data.size() ) size = data.size() - pos - 8;
+
+    if( !memcmp( &data[pos], "fmt ", 4 ) && size >= 16 ){
+      format           = readLE( body,      2 );
+      wav.channels     = readLE( body + 2,  2 );
+      wav.sample_rate  = readLE( body + 4,  4 );
+      bits             = readLE( body + 14, 2 );
+    } else if( !memcmp( &data[pos], "data", 4 ) ){
+      if( format != 1 || bits != 16 || wav.channels == 0 ){
+        fprintf( stderr, "etch-render: %s must be 16-bit PCM\n", path );
+        return false;
+      }
+      uint32_t frames = size / (2 * wav.channels);
+      wav.samples.resize( frames );
+      for( uint32_t i = 0; i<frames; i++ ) wav.samples[i] = int16_t( readLE( body + i * 2 * wav.channels, 2 ) );
+      return true;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  fprintf( stderr, "etch-render: %s has no data chunk\n", path );
+  return false;
+}
+
+// Writes a mono 16-bit PCM WAV file
+static bool writeWav( const char *path, uint32_t sample_rate, const std::vector<int16_t> &samples ){
+  FILE *f = fopen( path, "wb" );
+  if( !f ){ fprintf( stderr, "etch-render: can't write %s\n", path ); return false; }
+  uint32_t bytes = samples.size() * 2;
+  fwrite( "RIFF", 1, 4, f ); writeLE( f, 36 + bytes, 4 ); fwrite( "WAVE", 1, 4, f );
+  fwrite( "fmt ", 1, 4, f ); writeLE( f, 16, 4 ); writeLE( f, 1, 2 ); writeLE( f, 1, 2 );
+  writeLE( f, sample_rate, 4 ); writeLE( f, sample_rate * 2, 4 ); writeLE( f, 2, 2 ); writeLE( f, 16, 2 );
+  fwrite( "data", 1, 4, f ); writeLE( f, bytes, 4 );
+  for( size_t i = 0; i<samples.size(); i++ ) writeLE( f, uint16_t(samples[i]), 2 );
+  fclose( f );
+  return true;
+}
+
+
+/*******************************************
+* Rendering                                *
+*******************************************/
+
+// Stands in for the ADC0 RESRDY interrupt (the mock finishes every conversion as soon as it starts)
+static void serviceAdc( AdcPipe &pipe ){
+  while( ADC0.INTFLAGS & ADC_RESRDY_bm ) adcResultReady( pipe );
+}
+
+// Runs the whole file through the kernel. Returns the number of samples the kernel rendered
+static uint32_t render( const RenderSettings &rs, const Wav &in, std::vector<int16_t> &out ){
+  static uint16_t bitcrush_conversion[KERNEL_BITCRUSH_SIZE];
+  static KernelReverbCell reverb_buffer[kernelReverbBytes(REVERB_BUFFER_SIZE) / sizeof(KernelReverbCell)];
+  static uint16_t note_dac[KERNEL_NOTES];
+  uint16_t points[KERNEL_OCTAVES + 1];
+  kernelOctavePoints( points );                                 // An uncalibrated module (straight line)
+  kernelNoteTable( note_dac, points );
+
+  KernelParams p;
+  KernelState  s;
+  memset( &p, 0, sizeof(p) );
+  p.bitcrush      = bitcrush_conversion;
+  p.note_dac      = note_dac;
+  p.reverb_buffer = reverb_buffer;
+  p.reverb_size   = REVERB_BUFFER_SIZE;
+  kernelReverbClear( p );                                       // Cleared to the middle, like DSP::layoutArena
+  kernelReset( s );
+  s.rng = rs.seed ? rs.seed : 1;                                // xorshift can't start from zero
+
+  // Apply the settings the same way the DSP::setXXX functions do. The timer never changes, setSampleRateExp just
+  // sets how much phase every tick adds (See SAMPLE RATE NOTES in kernel.h)
+  uint32_t phase_inc = kernelPhaseInc( PHASE_INC, kernelRatePitch( rs.rate ) );
+  uint32_t inc       = rs.mode == RENDER_MODE_CV ? phase_inc / CV_CLOCK_DIVIDER : phase_inc;
+  KernelInputCal input_cal = { 0, 4096 };                       // An uncalibrated input (no correction)
+#if BITCRUSH_TABLE
+  kernelBitCrushTable( bitcrush_conversion, rs.crush, input_cal );
+#else
+  kernelBitCrushArith( p, rs.crush, input_cal );
+#endif
+  p.scale_crush     = rs.crush;
+  kernelAlpha( p, rs.filter );
+  p.glide           = kernelGlideCoef( rs.filter, kernelPhaseTicks( phase_inc / CV_CLOCK_DIVIDER, ISR_TICK_PERIOD ) );
+  p.resonance       = rs.resonance;
+  p.reverb_wet_mix  = rs.reverb_amount;
+  p.reverb_feedback = rs.reverb_feedback >> 1;
+  kernelReverbDelay( p, rs.reverb_delay );
+  kernelReverbSnap( s, p );                                     // Start on the taps, like DSP::layoutArena
+  p.note_offset     = rs.root;
+  p.scale_index     = rs.scale;
+  kernelScale( p.scale, p.scale_index, p.scale_crush );
+  p.quant_mode      = rs.quant_mode;
+
+  // Time between ISR ticks in seconds (always the same, whatever the rate)
+  double tick  = double( ISR_TICK_PERIOD ) / M_CLOCK_FRQ;
+  double frame = 1.0 / in.sample_rate;
+
+  // The input goes through the same ADC pipeline as the ISR (against the register mock), so both modes hear the
+  // result of the conversion started on the previous tick, just like the kernels do.
+  AdcPipe &pipe = adc_pipe;
+  uint8_t  mux  = rs.mode == RENDER_MODE_AUDIO ? ADC_MUXPOS_AIN0_gc : ADC_MUXPOS_AIN1_gc; // MUX_IN_AUD / MUX_IN_CV in dsp.h
+  ADC0.input[mux] = 0x200;
+  adcStart( pipe, mux );
+  serviceAdc( pipe );
+  DAC0.DATA = 0x200 << 6;                                       // The DAC holds its value between ticks
+
+  out.resize( in.samples.size() );
+  uint32_t ticks  = 0;
+  uint32_t phase  = 0;
+  double   next   = 0;                                          // Time of the next ISR tick
+
+  for( size_t i = 0; i<in.samples.size(); i++ ){
+    double now = i * frame;
+    while( next <= now ){
+      ADC0.input[mux] = uint16_t( int32_t(in.samples[i]) + 32768 ) >> 6; // 16-bit sample to the 10-bit ADC range
+      uint16_t val = adcNext( pipe );                           // The ADC converts on every tick
+      serviceAdc( pipe );
+      next += tick;
+      if( !kernelPhaseStep( phase, inc ) ) continue;            // and the DAC holds until the phase rolls over
+      if( rs.mode == RENDER_MODE_AUDIO ){
+        uint16_t crushed = kernelBitCrush( p, val );
+        if( rs.loop_mulaw ) crushed = MULAW.dec[ MULAW.enc[crushed] ]; // What a loop would play back (See LOOP STORAGE NOTES)
+        DAC0.DATA = kernelAudioSample( s, p, crushed ) << 6;
+      }
+      else                               DAC0.DATA = note_dac[ kernelCVNote( s, p, val ) ];
+      ticks++;
+    }
+    out[i] = int16_t( int32_t(DAC0.DATA) - 32768 );              // DAC0.DATA is already left aligned to 16 bits
+  }
+  return ticks;
+}
+
+
+/*******************************************
+* Loop Codec Report                        *
+*******************************************/
+
+// Compares the audio loop's mu-law storage against raw 16-bit words on the input file: the error each adds to the 10-bit
+// samples the ADC would read (as a signal to noise ratio) and how long a decode takes. The decode times are from this
+// computer, so only the ratio between them means anything for the AVR
+static void codecReport( const Wav &in ){
+  size_t n = in.samples.size();
+  std::vector<uint16_t> raw( n );
+  std::vector<uint8_t>  mu( n );
+  double signal = 0, noise_mu = 0;
+  for( size_t i = 0; i<n; i++ ){
+    raw[i] = uint16_t( int32_t(in.samples[i]) + 32768 ) >> 6;  // 16-bit sample to the 10-bit ADC range
+    mu[i]  = MULAW.enc[raw[i]];
+    double x = double(raw[i]) - 0x200;
+    double e = double(MULAW.dec[mu[i]]) - raw[i];
+    signal   += x * x;
+    noise_mu += e * e;
+  }
+  volatile uint32_t sink = 0;                                   // Keeps the decode loops from being optimized away
+  uint32_t sum = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for( uint8_t pass = 0; pass < 16; pass++ ) for( size_t i = 0; i<n; i++ ) sum += raw[i];
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  for( uint8_t pass = 0; pass < 16; pass++ ) for( size_t i = 0; i<n; i++ ) sum += MULAW.dec[mu[i]];
+  std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+  sink = sum;
+  double ns_raw = std::chrono::duration<double>( t1 - t0 ).count() * 1e9 / (16.0 * n);
+  double ns_mu  = std::chrono::duration<double>( t2 - t1 ).count() * 1e9 / (16.0 * n);
+
+  printf( "loop codec: raw 16-bit words: 2 bytes/sample, exact,           %.2f ns/decode\n", ns_raw );
+  if( noise_mu > 0 ) printf( "loop codec: mu-law:            1 byte/sample,  SNR %.1f dB, %.2f ns/decode\n", 10 * log10( signal / noise_mu ), ns_mu );
+  else               printf( "loop codec: mu-law:            1 byte/sample,  exact,           %.2f ns/decode\n", ns_mu );
+  (void)sink;
+}
+
+
+/*******************************************
+* Command Line                             *
+*******************************************/
+
+static void usage(){
+  fprintf( stderr,
+    "usage: etch-render [options] input.wav output.wav\n"
+    "  --mode audio|cv          DSP mode (default audio)\n"
+    "  --rate N                 Rate knob 0...1023 (default 1023)\n"
+    "  --crush N                Crush knob 0...1023 (default 0)\n"
+    "  --filter N               Filter knob 0...1023 (default 1023)\n"
+    "  --resonance N            Resonance menu setting 0...255\n"
+    "  --reverb-amount N        Reverb Amount menu setting 0...255\n"
+    "  --reverb-delay N         Reverb Delay menu setting 0...255\n"
+    "  --reverb-feedback N      Reverb Feedbk menu setting 0...255\n"
+    "  --root N                 Quant Root menu setting 0...12\n"
+    "  --scale N                Quant Scale menu setting 0...21\n"
+    "  --quant-mode N           Quant Mode menu setting 0...2 (nearest, up, down)\n"
+    "  --seed N                 Seed for the weighted scale randomization\n"
+    "  --loop-codec raw|mulaw   Play the input through the loop codec (raw or mu-law) and report each\n"
+    "                           codec's error and decode time (See LOOP STORAGE NOTES in kernel.h)\n" );
+}
+
+static bool parseNum( const char *arg, long max, long &val ){
+  char *end;
+  val = strtol( arg, &end, 10 );
+  return *arg && !*end && val >= 0 && val <= max;
+}
+
+int main( int argc, char **argv ){
+  RenderSettings rs;
+  bool codec_report = false;
+  const char *paths[2] = { NULL, NULL };
+  uint8_t npaths = 0;
+
+  for( int i = 1; i<argc; i++ ){
+    const char *a = argv[i];
+    if( a[0] != '-' || a[1] != '-' ){
+      if( npaths == 2 ){ usage(); return 1; }
+      paths[npaths++] = a;
+      continue;
+    }
+    if( i + 1 >= argc ){ usage(); return 1; }
+    const char *v = argv[++i];
+    long n = 0;
+    bool ok = true;
+    if(      !strcmp( a, "--mode" ) ){
+      if(      !strcmp( v, "audio" ) ) rs.mode = RENDER_MODE_AUDIO;
+      else if( !strcmp( v, "cv"    ) ) rs.mode = RENDER_MODE_CV;
+      else ok = false;
+    }
+    else if( !strcmp( a, "--loop-codec" ) ){
+      codec_report = true;
+      if(      !strcmp( v, "raw"   ) ) rs.loop_mulaw = false;
+      else if( !strcmp( v, "mulaw" ) ) rs.loop_mulaw = true;
+      else ok = false;
+    }
+    else if( !strcmp( a, "--rate"            ) ){ ok = parseNum( v, 1023, n ); rs.rate            = n; }
+    else if( !strcmp( a, "--crush"           ) ){ ok = parseNum( v, 1023, n ); rs.crush           = n; }
+    else if( !strcmp( a, "--filter"          ) ){ ok = parseNum( v, 1023, n ); rs.filter          = n; }
+    else if( !strcmp( a, "--resonance"       ) ){ ok = parseNum( v, 255,  n ); rs.resonance       = n; }
+    else if( !strcmp( a, "--reverb-amount"   ) ){ ok = parseNum( v, 255,  n ); rs.reverb_amount   = n; }
+    else if( !strcmp( a, "--reverb-delay"    ) ){ ok = parseNum( v, 255,  n ); rs.reverb_delay    = n; }
+    else if( !strcmp( a, "--reverb-feedback" ) ){ ok = parseNum( v, 255,  n ); rs.reverb_feedback = n; }
+    else if( !strcmp( a, "--root"            ) ){ ok = parseNum( v, 12,   n ); rs.root            = n; }
+    else if( !strcmp( a, "--scale"           ) ){ ok = parseNum( v, 21,   n ); rs.scale           = n; }
+    else if( !strcmp( a, "--quant-mode"      ) ){ ok = parseNum( v, 2,    n ); rs.quant_mode      = n; }
+    else if( !strcmp( a, "--seed"            ) ){ ok = parseNum( v, 0xFFFF,     n ); rs.seed      = n; }
+    else ok = false;
+    if( !ok ){ fprintf( stderr, "etch-render: bad option %s %s\n", a, v ); usage(); return 1; }
+  }
+  if( npaths != 2 ){ usage(); return 1; }
+
+  Wav in;
+  if( !readWav( paths[0], in ) ) return 1;
+
+  std::vector<int16_t> out;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint32_t ticks = render( rs, in, out );
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+  if( !writeWav( paths[1], in.sample_rate, out ) ) return 1;
+
+  double length = double( in.samples.size() ) / in.sample_rate;
+  printf( "rendered %.2f s of audio (%u kernel samples) in %.3f ms\n", length, ticks, seconds * 1000 );
+  printf( "throughput: %.0f samples/sec (%.1fx realtime)\n", seconds > 0 ? ticks / seconds : 0, seconds > 0 ? length / seconds : 0 );
+  if( codec_report ) codecReport( in );
+  return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ETCH Firmware source code designed to run on the AVR128DA28.
+Copyright (C) 2024 Tyler Klein (Things Made Simple)
+Etch Hardware Design by Juanito Moore (Modular for the Masses)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+--- Description: ---
+etch-test runs the parts of the firmware that only ever see registers and
+tables (kernel.h, adc.h) through a set of desktop checks, against the same
+register mock etch-render uses. Each check prints ok or FAIL, and the exit
+code is the number of checks that failed.
+
+Build & run (from the root of the repository):
+  g++ -O2 -std=c++14 -o etch-test tools/etch-test/etch-test.cpp
+  ./etch-test
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../etch-render/avr_mock.h"
+#include "../../kernel.h"
+#include "../../adc.h"
+
+
+/*******************************************
+* Reporting                                *
+*******************************************/
+
+int failures = 0;
+
+void check( bool ok, const char *what ){
+  printf( "%s  %s\n", ok ? "ok  " : "FAIL", what );
+  if( !ok ) failures++;
+}
+
+
+/*******************************************
+* Bitcrush Table Rebuild                   *
+*******************************************/
+
+// Same double-buffered rebuild as DSP::setBitCrush / DSP::buildBitCrush / DSP::process, minus the interrupts
+struct CrushTables {
+  uint16_t tables[2][KERNEL_BITCRUSH_SIZE];
+  uint16_t *front = tables[0];
+  KernelCrushBuild build = {};
+  KernelInputCal cal = { 0, 4096 };
+  uint16_t swaps = 0;
+
+  void set( uint16_t bc ){ kernelBitCrushRequest( build, bc ); }
+  void process( uint16_t chunk ){
+    if( !build.building ) return;
+    uint16_t *back = (front == tables[0]) ? tables[1] : tables[0];
+    if( !kernelBitCrushBuild( build, back, cal, chunk ) ) return;
+    front = back;
+    swaps++;
+    kernelBitCrushDone( build );
+  }
+};
+
+// A crush knob that moves before every single process() call (a sweep, or a CV on the crush input) still has to get
+// a fresh table swapped in, and once it stops the front table has to end up on the last setting
+void testBitCrushSweep(){
+  CrushTables c;
+  uint16_t reference[KERNEL_BITCRUSH_SIZE];
+
+  uint16_t bc = 0;
+  for( uint16_t i = 0; i < 64; i++ ){                           // 64 knob moves, one process() call after each. The chunk
+    bc = (i * 37) & 0x3FF;                                      // size means a table takes 8 calls, so the knob moves 8 times
+    c.set( bc );                                                // during every build
+    c.process( 128 );
+  }
+  check( c.swaps >= 7, "bitcrush: a moving knob still gets tables swapped in" );
+
+  for( uint16_t i = 0; i < 32 && c.build.building; i++ ) c.process( 128 ); // Knob stops: the queued build finishes
+  check( !c.build.building, "bitcrush: the build settles once the knob stops" );
+
+  kernelBitCrushTable( reference, bc, c.cal );
+  check( memcmp( c.front, reference, sizeof(reference) ) == 0, "bitcrush: the front table matches the last setting" );
+}
+
+
+/*******************************************
+* ADC Pipeline                             *
+*******************************************/
+
+#define TEST_AUD_MUX    ADC_MUXPOS_AIN0_gc                      // MUX_IN_AUD in dsp.h
+#define TEST_SCAN_COUNT 6
+
+const uint8_t TEST_SCAN_LIST[TEST_SCAN_COUNT] = { 2, 3, 4, 5, 16, 17 }; // Same channels as ADC_SCAN_LIST in hardware.h
+
+// Control readings are tagged so a mixed up result can't pass: the top bits say which slot the channel belongs to and the
+// low 6 bits count how many times the knobs have moved
+inline uint16_t testKnob( uint8_t slot, uint8_t round ){ return 0x200 + (slot << 6) + (round & 0x3F); }
+
+struct PipeRun {
+  const char *name;
+  uint16_t per;                                                 // TCA0.SINGLE.PER
+  uint16_t conversion;                                          // TCA0 counts each conversion takes (when RESRDY comes up)
+  uint16_t isr_min, isr_max;                                    // Range of counts the ISR runs for (RESRDY waits until it's done)
+  uint16_t ticks;                                               // ISR ticks to run
+};
+
+struct PipeStats {
+  uint16_t audio_bad  = 0;                                      // Ticks where adcNext() didn't hand back the previous tick's sample
+  uint16_t scan_bad   = 0;                                      // Control results out of order, in the wrong slot or stale
+  uint16_t scans      = 0;                                      // Control results filed
+  uint16_t pending    = 0;                                      // adcStart() had to wait for a control conversion
+  uint16_t chained    = 0;                                      // adcResultReady() started a control conversion
+  uint16_t short_time = 0;                                      // The ADC was free for a control conversion but the time was too short
+};
+
+// The ADC0 RESRDY interrupt. It only gets in once the ISR is done, since the audio ISR is level-1
+static void testResultReady( AdcPipe &a, PipeStats &st, uint8_t &next_slot, uint8_t round ){
+  while( ADC0.INTFLAGS & ADC_RESRDY_bm ){
+    bool     scan   = a.scanning;
+    uint8_t  slot   = a.scan_index;
+    uint32_t before = ADC0.conversions;
+    adcResultReady( a );
+    if( scan ){                                                 // Each control result has to land in the next slot of the
+      st.scans++;                                               // round-robin, holding its own channel's latest reading
+      uint16_t v = a.scan[slot];                                // (or the one before, if the knob moved mid conversion)
+      bool fresh = v == testKnob( slot, round ) || v == testKnob( slot, round - 1 );
+      if( slot != next_slot || !fresh ) st.scan_bad++;
+      next_slot = (slot + 1) % TEST_SCAN_COUNT;
+    } else if( a.scanning && ADC0.conversions != before ){
+      st.chained++;
+    } else if( !a.busy && !a.pending ){                         // The ADC was free to chain one, so the only thing
+      st.short_time++;                                          // that held it off was the time left
+    }
+  }
+}
+
+// Runs the audio kernel's side of the pipeline (adcNext at the top of the ISR, adcScanNext at the bottom) against a mock
+// ADC that takes a while to convert. The audio input changes at every overflow, so tick n has to collect tick n-1's input
+static PipeStats testPipe( const PipeRun &r ){
+  PipeStats st;
+  AdcPipe   a = {};
+  uint8_t   next_slot = 0;
+  uint8_t   round = 0;
+  uint32_t  rng = 1;
+  char      what[96];
+
+  ADC0.conversion_ticks = 0;                                    // adcScanSetup() polls, and the mock clock can't move while it spins
+  ADC0.INTFLAGS   = 0;
+  ADC0.remaining  = 0;
+  ADC0.collisions = 0;
+  for( uint8_t i = 0; i < TEST_SCAN_COUNT; i++ ) ADC0.input[TEST_SCAN_LIST[i]] = testKnob( i, round );
+  adcScanSetup( a, TEST_SCAN_LIST, TEST_SCAN_COUNT );
+  for( uint8_t i = 0; i < TEST_SCAN_COUNT; i++ ) if( a.scan[i] != testKnob( i, round ) ) st.scan_bad++;
+
+  ADC0.conversion_ticks = r.conversion;
+  TCA0.SINGLE.PER = r.per;
+  TCA0.SINGLE.CNT = 0;
+  ADC0.input[TEST_AUD_MUX] = 0;
+  adcStart( a, TEST_AUD_MUX );                                  // Primed like DSP::setMode
+
+  for( uint16_t n = 1; n <= r.ticks; n++ ){
+    while( !mockTick() ) testResultReady( a, st, next_slot, round ); // Idle until the overflow, taking RESRDY as it comes
+
+    if( n % 64 == 0 ){                                          // Every so often the knobs move
+      round++;
+      for( uint8_t i = 0; i < TEST_SCAN_COUNT; i++ ) ADC0.input[TEST_SCAN_LIST[i]] = testKnob( i, round );
+    }
+    ADC0.input[TEST_AUD_MUX] = n & 0x1FF;
+    if( adcNext( a ) != ((n - 1) & 0x1FF) ) st.audio_bad++;
+    if( a.pending ) st.pending++;
+
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    uint16_t isr = r.isr_min + rng % (r.isr_max - r.isr_min + 1);
+    for( uint16_t c = 0; c < isr; c++ ) mockTick();             // The kernel runs with RESRDY held off
+    bool free = !a.busy && !a.scanning && !a.pending;
+    adcScanNext( a );
+    if( free && !a.scanning ) st.short_time++;
+  }
+
+  snprintf( what, sizeof(what), "adc %s: every tick collects the previous tick's sample", r.name );
+  check( st.audio_bad == 0, what );
+  snprintf( what, sizeof(what), "adc %s: controls come back in order, fresh and in their own slot", r.name );
+  check( st.scan_bad == 0 && st.scans >= r.ticks / 4, what );
+  snprintf( what, sizeof(what), "adc %s: no conversion started on top of another", r.name );
+  check( ADC0.collisions == 0, what );
+  printf( "      %u scans, %u pending, %u chained, %u short of time\n", st.scans, st.pending, st.chained, st.short_time );
+  return st;
+}
+
+// RESRDY early: conversions well inside the ADC_CONVERSION_TICKS budget, and an ISR that sometimes runs long enough
+// that there's no time left to chain a control conversion after it
+void testAdcEarly(){
+  PipeStats st = testPipe( { "early", 2000, 100, 50, 1800, 2000 } );
+  check( st.chained > 0,    "adc early: adcResultReady() chains a control conversion" );
+  check( st.short_time > 0, "adc early: adcScanNext() holds off when there's no time left" );
+  check( st.pending == 0,   "adc early: so the ISR never has to wait on a control conversion" );
+}
+
+// RESRDY late: the conversion takes longer than ADC_CONVERSION_TICKS, so a control conversion that started with just
+// enough time left is still running at the next overflow and the ISR's own conversion has to wait on it
+void testAdcLate(){
+  PipeStats st = testPipe( { "late", 1000, 550, 100, 100, 2000 } );
+  check( st.pending > 0, "adc late: adcStart() waits on a running control conversion" );
+}
+
+
+/*******************************************
+* Main                                     *
+*******************************************/
+
+int main(){
+  testBitCrushSweep();
+  testAdcEarly();
+  testAdcLate();
+  printf( "%d failed\n", failures );
+  return failures;
+}
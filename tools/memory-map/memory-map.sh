@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+# ETCH Firmware source code designed to run on the AVR128DA28.
+# Copyright (C) 2024 Tyler Klein (Things Made Simple)
+# Etch Hardware Design by Juanito Moore (Modular for the Masses)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# --- Description: ---
+# Lists how much RAM every buffer and variable in a firmware build takes, biggest
+# first, followed by the PROGMEM_MAPPED tables that stay in the memory mapped
+# flash. Run it on the .elf the Arduino IDE leaves behind ("Sketch > Export
+# Compiled Binary") or the one from arduino-cli:
+#
+#   arduino-cli compile --fqbn DxCore:megaavr:avrda:chip=avr128da28 --output-dir build .
+#   tools/memory-map/memory-map.sh build/Etch.ino.elf
+#
+# avr-nm and avr-size come with the DxCore toolchain. Set AVR_PREFIX if they aren't
+# on the PATH (e.g. AVR_PREFIX=~/.arduino15/packages/DxCore/tools/avr-gcc/7.3.0-atmel3.6.1-azduino7b1/bin/avr-).
+
+RAM_SIZE=16384                                                  # AVR128DA28 SRAM
+ELF="$1"
+NM="${AVR_PREFIX}avr-nm"
+SIZE="${AVR_PREFIX}avr-size"
+
+if [ -z "$ELF" ] || [ ! -f "$ELF" ]; then
+  echo "usage: $0 firmware.elf" >&2
+  exit 1
+fi
+
+# RAM: initialized (d/D) and zeroed (b/B) data. --radix=d prints the sizes in decimal
+echo "RAM (bytes, .data + .bss):"
+"$NM" --size-sort --reverse-sort --radix=d -S -C "$ELF" | awk -v ram="$RAM_SIZE" '
+  $3 ~ /^[dDbB]$/ {
+    size = $2 + 0; total += size
+    name = $4; for( i = 5; i <= NF; i++ ) name = name " " $i
+    printf "  %6d  %s\n", size, name
+  }
+  END {
+    printf "  ------\n  %6d  total static (%d left for the heap & stack)\n", total, ram - total
+  }'
+
+# Flash: PROGMEM_MAPPED tables (r/R). Plain const tables end up in the RAM list above, since DxCore copies .rodata to RAM
+echo
+echo "Mapped flash (bytes, PROGMEM_MAPPED tables):"
+"$NM" --size-sort --reverse-sort --radix=d -S -C "$ELF" | awk '
+  $3 ~ /^[rR]$/ {
+    size = $2 + 0; total += size
+    name = $4; for( i = 5; i <= NF; i++ ) name = name " " $i
+    if( size >= 16 ) printf "  %6d  %s\n", size, name
+  }
+  END { printf "  ------\n  %6d  total\n", total }'
+
+echo
+"$SIZE" -A "$ELF" | grep -E "^(section|\.text|\.rodata|\.data|\.bss|\.noinit)"